@@ -1,57 +1,288 @@
 #include <algorithm>
+#include <array>
 #include <cmath>
 #include <cstdint>
+#include <cstring>
 #include <deque>
 #include <functional>
+#include <initializer_list>
 #include <iostream>
 #include <istream>
+#include <iterator>
+#include <new>
 #include <ostream>
 #include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
+#ifndef LL_CHECK
+#ifdef LL_DEBUG
+#define LL_CHECK true
+#else
+#define LL_CHECK false
+#endif
+#endif
+
+#ifndef LL_HUGE_PAGE
+#ifdef __linux__
+#define LL_HUGE_PAGE true
+#else
+#define LL_HUGE_PAGE false
+#endif
+#endif
+
+#if LL_HUGE_PAGE
+#include <sys/mman.h>
+#define LL_MADVISE_HUGE(ptr, len) madvise(ptr, len, MADV_HUGEPAGE)
+#else
+#define LL_MADVISE_HUGE(ptr, len) 0
+#endif
+
 /// @brief LapisLazuli is a collection of utilities for OI.
 namespace ll {
 
 typedef __int128_t int128_t;
+typedef __uint128_t uint128_t;
 
-/// @brief Compute factorial for integer.
-/// @param n a positive integer to compute factorial for
-/// @return the result of factorial
-///
-/// The behavior is undefined unless `n>0`.
-constexpr int32_t fact(int32_t n) noexcept {
-    return n == 0 ? 1 : n * fact(n - 1);
-}
+/// @brief End marker of single-pass ranges. Their iterators compare against
+/// it, so that `end()` never builds a second iterator.
+struct Sentinel final {};
 
 /// @brief Iterator for base-n digits of an integer.
+/// @tparam N the base, at least 2
+/// @tparam T the integer type, up to `int128_t`
 /// @note The order of which digits come from the iterator is reverse from how
 /// they are written, i.e. the last digit will be the **first** element from the
-/// iterator.
+/// iterator. Digits of a negative number are negative.
+///
+/// A 128-bit value is split into 64-bit chunks of `K` digits each, and the
+/// digits of each chunk come from 64-bit arithmetic. Every division is by a
+/// constant: a power-of-two `N` uses shifts and masks, a 64-bit operand
+/// multiplies by the reciprocal the compiler derives from `N`, and a 128-bit
+/// chunk is peeled with the precomputed reciprocal `INV` of Möller and
+/// Granlund instead of a 128-bit division libcall.
 template <int32_t N, typename T = int32_t> class BaseN final {
+    static_assert(N >= 2, "base must be at least 2");
+    /// @brief Whether `T` needs to be split into 64-bit chunks.
+    static constexpr bool WIDE = sizeof(T) > sizeof(uint64_t);
+    /// @brief log2(N) if `N` is a power of two, otherwise 0.
+    static constexpr int SHIFT = (N & (N - 1)) == 0 ? __builtin_ctz(N) : 0;
+
+    /// @brief Number of digits in a chunk, the largest k with N^k < 2^64.
+    static constexpr uint32_t K = [] {
+        uint32_t k = 0;
+        for (uint64_t p = 1; p <= UINT64_MAX / N; p *= N)
+            k++;
+        return k;
+    }();
+
+    /// @brief N^K, the divisor which peels off a chunk.
+    static constexpr uint64_t CHUNK = [] {
+        uint64_t p = 1;
+        for (uint32_t i = 0; i < K; i++)
+            p *= N;
+        return p;
+    }();
+
+    /// @brief Shift which normalizes `CHUNK` to have its top bit set.
+    static constexpr int NORM = __builtin_clzll(CHUNK);
+    /// @brief floor((2^128 - 1) / (CHUNK << NORM)) - 2^64.
+    static constexpr uint64_t INV = uint64_t(~uint128_t(0) / (CHUNK << NORM));
+
+    /// @brief N^i for every i with N^i < 2^128, and how many there are.
+    static constexpr auto POW = [] {
+        auto res = std::array<uint128_t, 129>();
+        uint128_t p = 1;
+        for (uint32_t i = 0;; i++) {
+            res[i] = p;
+            if (p > ~uint128_t(0) / N)
+                break;
+            p *= N;
+        }
+        return res;
+    }();
+    static constexpr uint32_t POWS = [] {
+        uint32_t i = 1;
+        while (i < POW.size() && POW[i] > POW[i - 1])
+            i++;
+        return i;
+    }();
+
+    /// @brief `LOWER[b]` is the number of digits of 2^(b - 1), which a
+    /// `b`-bit value either has or exceeds by one.
+    static constexpr auto LOWER = [] {
+        auto res = std::array<uint8_t, 129>();
+        for (uint32_t b = 1, d = 0; b <= 128; b++) {
+            while (d < POWS && POW[d] <= uint128_t(1) << (b - 1))
+                d++;
+            res[b] = uint8_t(d);
+        }
+        return res;
+    }();
+
+    /// @brief Number of digits of `m`, in O(1) by `clz` and `POW`.
+    static constexpr uint32_t count(uint128_t m) noexcept {
+        if (m == 0)
+            return 0;
+        auto hi = uint64_t(m >> 64), lo = uint64_t(m);
+        auto bits = hi != 0 ? 128 - __builtin_clzll(hi)
+                            : 64 - __builtin_clzll(lo);
+        uint32_t d = LOWER[bits];
+        return d + (d < POWS && m >= POW[d]);
+    }
+
+    /// @brief Absolute value of `num`.
+    static constexpr uint128_t magnitude(T num) noexcept {
+        return num < T(0) ? -uint128_t(num) : uint128_t(num);
+    }
+
+    /// @brief Remove the lowest digit of `x` and return it, with a single
+    /// multiply for the quotient and the remainder together.
+    static constexpr uint32_t split(uint64_t& x) noexcept {
+        if constexpr (SHIFT != 0) {
+            auto d = uint32_t(x & (N - 1));
+            x >>= SHIFT;
+            return d;
+        } else {
+            auto q = x / N;
+            auto d = uint32_t(x - q * N);
+            x = q;
+            return d;
+        }
+    }
+
+    /// @brief Remove the lowest chunk of `x` and return it.
+    static constexpr uint64_t peel(uint128_t& x) noexcept {
+        if constexpr (SHIFT != 0) {
+            auto c = uint64_t(x) & (CHUNK - 1);
+            x >>= SHIFT * K;
+            return c;
+        } else {
+            uint64_t hi = uint64_t(x >> 64), lo = uint64_t(x);
+            auto q_hi = hi / CHUNK;
+            auto r = hi - q_hi * CHUNK;
+            // divide r:lo, where r < CHUNK, by the normalized divisor
+            constexpr auto d = CHUNK << NORM;
+            auto n1 = NORM == 0 ? r : r << NORM | lo >> (64 - NORM);
+            auto n0 = lo << NORM;
+            auto p = uint128_t(INV) * n1 + (uint128_t(n1 + 1) << 64 | n0);
+            auto q = uint64_t(p >> 64);
+            auto rem = n0 - q * d;
+            if (rem > uint64_t(p))
+                q--, rem += d;
+            if (rem >= d)
+                q++, rem -= d;
+            x = uint128_t(q_hi) << 64 | q;
+            return rem >> NORM;
+        }
+    }
+
   public:
     /// @brief The number to convert into digits.
-    int32_t const num;
-    constexpr BaseN(int32_t num) noexcept : num(num) {}
+    T const num;
+    constexpr BaseN(T num) noexcept : num(num) {}
     class Iterator final {
-        int32_t curr;
+        /// @brief The chunks not yet loaded, only used if `WIDE`.
+        uint128_t rest = 0;
+        /// @brief The digits of the current chunk after `digit`.
+        uint64_t chunk = 0;
+        /// @brief Digits left in `chunk` before the next one is loaded.
+        uint32_t left = 0;
+        uint32_t digit = 0;
+        bool neg;
+
+        constexpr void take() noexcept {
+            if constexpr (WIDE) {
+                if (this->left == 0 && this->rest != 0)
+                    this->chunk = peel(this->rest), this->left = K;
+                if (this->left != 0)
+                    this->left--;
+            }
+            this->digit = split(this->chunk);
+        }
 
       public:
-        constexpr Iterator(int32_t curr) noexcept : curr(curr) {}
-        constexpr int32_t operator*() const noexcept { return this->curr % N; }
+        constexpr Iterator(T num) noexcept : neg(num < T(0)) {
+            auto mag = magnitude(num);
+            if constexpr (WIDE)
+                this->rest = mag;
+            else
+                this->chunk = uint64_t(mag);
+            this->take();
+        }
+        constexpr int32_t operator*() const noexcept {
+            return this->neg ? -int32_t(this->digit) : int32_t(this->digit);
+        }
         constexpr Iterator& operator++() noexcept {
-            this->curr /= N;
+            this->take();
             return *this;
         }
-        constexpr bool operator!=(Iterator const& rhs) const noexcept {
-            return this->curr != rhs.curr;
+        constexpr bool operator!=(Sentinel) const noexcept {
+            return (this->digit | this->chunk | this->rest) != 0;
         }
     };
     constexpr Iterator begin() const noexcept { return Iterator(num); }
-    constexpr Iterator end() const noexcept { return Iterator(0); }
-    inline operator std::vector<int32_t>() const noexcept {
-        auto res = std::vector<int32_t>();
+    constexpr Sentinel end() const noexcept { return Sentinel(); }
+
+    /// @brief Number of digits, in O(1). Zero has none.
+    constexpr uint32_t size() const noexcept {
+        return count(magnitude(this->num));
+    }
+
+    /// @brief The digits in written order, most significant first, stored
+    /// inline. Obtained from `BaseN::digits()`.
+    ///
+    /// # Example
+    ///
+    /// ```cpp
+    ///
+    /// for (auto d : ll::BaseN<10>(1234).digits()) std::cout << d;
+    ///
+    /// // 1234
+    ///
+    /// ```
+    class Digits final {
+        std::array<int32_t, count(~uint128_t(0) >> (128 - 8 * sizeof(T)))>
+            buf = {};
+        uint32_t len;
+
+      public:
+        /// @brief Fill the digits from the last, as `size()` is known.
+        constexpr Digits(BaseN const& base) noexcept : len(base.size()) {
+            auto i = this->len;
+            for (auto d : base)
+                this->buf[--i] = d;
+        }
+        constexpr uint32_t size() const noexcept { return this->len; }
+        constexpr int32_t operator[](uint32_t i) const noexcept {
+            return this->buf[i];
+        }
+        constexpr int32_t const* begin() const noexcept {
+            return this->buf.data();
+        }
+        constexpr int32_t const* end() const noexcept {
+            return this->buf.data() + this->len;
+        }
+        /// @brief Iterate from the least significant digit.
+        constexpr auto rbegin() const noexcept {
+            return std::reverse_iterator(this->end());
+        }
+        constexpr auto rend() const noexcept {
+            return std::reverse_iterator(this->begin());
+        }
+    };
+
+    /// @brief The digits in written order, see `Digits`.
+    constexpr Digits digits() const noexcept { return Digits(*this); }
+
+    template <typename D = int32_t>
+    inline operator std::vector<D>() const noexcept {
+        auto res = std::vector<D>();
+        res.reserve(this->size());
         for (auto i : *this)
-            res.push_back(i);
+            res.push_back(D(i));
         return res;
     }
 };
@@ -67,6 +298,200 @@ template <typename T> constexpr void panic(T msg) noexcept {
 /// @brief Abort the program execution. The same as `std::abort`.
 constexpr void panic() noexcept { panic(""); }
 
+/// @brief Table of the factorials 0! to N!, computed at compile time.
+/// @tparam T integer type
+/// @tparam N the largest argument
+template <typename T, uintptr_t N>
+constexpr std::array<T, N + 1> fact_table() noexcept {
+    auto res = std::array<T, N + 1>();
+    res[0] = 1;
+    for (uintptr_t i = 1; i <= N; i++)
+        res[i] = res[i - 1] * T(i);
+    return res;
+}
+
+/// @brief Factorials up to 20!, all that fit in `uint64_t`.
+inline constexpr auto FACT64 = fact_table<uint64_t, 20>();
+
+/// @brief Factorials up to 33!, all that fit in `int128_t`.
+inline constexpr auto FACT128 = fact_table<int128_t, 33>();
+
+/// @brief Factorial of `n` by table lookup, aborting if it overflows `T`.
+/// @tparam T result type, `int32_t` by default
+/// @param n a non-negative integer to compute factorial for
+/// @return the result of factorial
+template <typename T = int32_t> constexpr T fact(uintptr_t n) noexcept {
+    if constexpr (sizeof(T) <= sizeof(uint64_t)) {
+        if (n > 20 || uint64_t(T(FACT64[n])) != FACT64[n])
+            panic("fact: overflow");
+        return T(FACT64[n]);
+    } else {
+        if (n > 33 || int128_t(T(FACT128[n])) != FACT128[n])
+            panic("fact: overflow");
+        return T(FACT128[n]);
+    }
+}
+
+/// @brief Binomial coefficients modulo `Mod`.
+/// @tparam Mod the modulus
+///
+/// For prime `Mod`, factorials and inverse factorials are tabulated in O(n)
+/// with a single modular inverse and a backward sweep, and extend lazily, so
+/// that `C(n, k)` is O(1) amortized. Arguments beyond the modulus fall back
+/// to Lucas' theorem. For a prime power `Mod = p^e`, `granville` uses
+/// Granville's generalization of Lucas' theorem instead.
+///
+/// # Example
+///
+/// ```cpp
+///
+/// auto C = ll::Binom<998244353>(10000000);
+///
+/// C(10, 3); // 120
+///
+/// ```
+template <uint64_t Mod> class Binom final {
+    static_assert(Mod > 1, "modulus must be greater than 1");
+    /// @brief Table entry type, 32-bit when residues fit.
+    using V = std::conditional_t<(Mod <= UINT32_MAX), uint32_t, uint64_t>;
+    std::vector<V> f = {1}, inv = {1};
+    /// @brief Products of [1, i] skipping multiples of p, modulo p^e, for
+    /// `granville`.
+    std::vector<V> unit;
+
+  public:
+    /// @brief Multiply modulo `Mod`.
+    static constexpr uint64_t mul(uint64_t a, uint64_t b) noexcept {
+        if constexpr (Mod <= UINT32_MAX)
+            return a * b % Mod;
+        else
+            return uint64_t(uint128_t(a) * b % Mod);
+    }
+
+    /// @brief Raise `a` to the power of `e` modulo `Mod`.
+    static constexpr uint64_t pow(uint64_t a, uint64_t e) noexcept {
+        uint64_t res = 1 % Mod;
+        for (a %= Mod; e > 0; e >>= 1, a = mul(a, a))
+            if (e & 1)
+                res = mul(res, a);
+        return res;
+    }
+
+    /// @brief Inverse of `a` modulo `Mod`, by extended Euclid.
+    /// @warning `a` must be coprime to `Mod`.
+    static constexpr uint64_t inverse(uint64_t a) noexcept {
+        int128_t x = 0, y = 1, m = Mod, r = a % Mod;
+        while (r != 0) {
+            auto q = m / r;
+            std::swap(m, r), r -= q * m;
+            std::swap(x, y), y -= q * x;
+        }
+        return uint64_t(x < 0 ? x + Mod : x);
+    }
+
+    /// @brief Create with tables up to `n`.
+    Binom(uintptr_t n = 0) { this->reserve(n); }
+
+    /// @brief Extend the tables to cover `n`, capped at `Mod - 1`.
+    inline void reserve(uintptr_t n) {
+        n = std::min<uint64_t>(n, Mod - 1);
+        auto old = this->f.size();
+        if (n < old)
+            return;
+        this->f.resize(n + 1);
+        this->inv.resize(n + 1);
+        for (auto i = old; i <= n; i++)
+            this->f[i] = mul(this->f[i - 1], i);
+        this->inv[n] = inverse(this->f[n]);
+        for (auto i = n; i > old; i--)
+            this->inv[i - 1] = mul(this->inv[i], i);
+    }
+
+    /// @brief `n!` modulo prime `Mod`, for `n < Mod`.
+    inline uint64_t fact(uintptr_t n) {
+        if (n >= this->f.size())
+            this->reserve(std::max(n, 2 * this->f.size()));
+        return this->f[n];
+    }
+
+    /// @brief Inverse of `n!` modulo prime `Mod`, for `n < Mod`.
+    inline uint64_t inv_fact(uintptr_t n) {
+        if (n >= this->f.size())
+            this->reserve(std::max(n, 2 * this->f.size()));
+        return this->inv[n];
+    }
+
+    /// @brief Binomial coefficient C(n, k) modulo prime `Mod`. This is O(1)
+    /// amortized for `n < Mod`, and goes through `lucas` otherwise.
+    inline uint64_t operator()(uint64_t n, uint64_t k) {
+        if (k > n)
+            return 0;
+        if (n >= Mod)
+            return this->lucas(n, k);
+        return mul(mul(this->fact(n), this->inv_fact(k)),
+                   this->inv_fact(n - k));
+    }
+
+    /// @brief Binomial coefficient C(n, k) modulo prime `Mod` by Lucas'
+    /// theorem, in O(log n / log Mod) table lookups. Meant for small `Mod`.
+    inline uint64_t lucas(uint64_t n, uint64_t k) {
+        uint64_t res = 1 % Mod;
+        for (; k > 0 && res != 0; n /= Mod, k /= Mod) {
+            auto ni = n % Mod, ki = k % Mod;
+            if (ki > ni)
+                return 0;
+            res = mul(res, (*this)(ni, ki));
+        }
+        return res;
+    }
+
+    /// @brief Binomial coefficient C(n, k) modulo a prime power
+    /// `Mod = p^e`, by Granville's generalization of Lucas' theorem.
+    ///
+    /// With `n!_p` the product of [1, n] with all factors of p removed,
+    /// C(n, k) = p^v n!_p / (k!_p (n-k)!_p), where v counts the carries of
+    /// k + (n-k) in base p. Each `n!_p` takes O(log n) lookups into a table
+    /// of size p^e, built on the first call.
+    inline uint64_t granville(uint64_t n, uint64_t k) {
+        static auto const p = [] {
+            uint64_t d = 2;
+            while (d * d <= Mod && Mod % d != 0)
+                d++;
+            return Mod % d == 0 ? d : Mod;
+        }();
+        if (k > n)
+            return 0;
+        if (this->unit.empty()) {
+            this->unit.resize(Mod);
+            this->unit[0] = 1 % Mod;
+            for (uint64_t i = 1; i < Mod; i++)
+                this->unit[i] = i % p ? mul(this->unit[i - 1], i)
+                                      : this->unit[i - 1];
+        }
+        // a full block of Mod numbers contributes unit[Mod - 1], which is -1
+        // unless p = 2 and e >= 3 (Gauss' generalization of Wilson)
+        uint64_t block = this->unit[Mod - 1];
+        auto part = [&](uint64_t m) {
+            uint64_t res = 1 % Mod;
+            for (; m > 0; m /= p)
+                res = mul(mul(res, this->unit[m % Mod]),
+                          block == 1 ? 1 : pow(block, m / Mod));
+            return res;
+        };
+        auto legendre = [&](uint64_t m) {
+            uint64_t v = 0;
+            for (m /= p; m > 0; m /= p)
+                v += m;
+            return v;
+        };
+        auto v = legendre(n) - legendre(k) - legendre(n - k);
+        auto res = mul(part(n), inverse(mul(part(k), part(n - k))));
+        for (; v > 0 && res != 0; v--)
+            res = mul(res, p);
+        return res;
+    }
+};
+
 /// @brief An integer range. This is useful when you would like to loop over
 /// some consecutive integers.
 /// @tparam T type of integer, `int` by default
@@ -126,7 +551,124 @@ template <typename T> constexpr Range<T> rng(T term) noexcept {
     return Range(T(), term);
 }
 
+/// @brief Fenwick tree (binary indexed tree) over prefix sums.
+/// @tparam T value type
+template <typename T = int64_t> class Fenwick final {
+    /// @brief One-based implicit tree.
+    std::vector<T> tree;
+
+  public:
+    /// @brief Create a tree of `n` zeros.
+    constexpr Fenwick(uintptr_t n) : tree(std::vector<T>(n + 1)) {}
+
+    /// @brief Create a tree of `n` copies of `value` in O(n).
+    constexpr Fenwick(uintptr_t n, T value) : tree(std::vector<T>(n + 1)) {
+        for (uintptr_t i = 1; i <= n; i++) {
+            this->tree[i] += value;
+            if (auto j = i + (i & -i); j <= n)
+                this->tree[j] += this->tree[i];
+        }
+    }
+
+    /// @brief Number of values.
+    constexpr uintptr_t size() const noexcept { return this->tree.size() - 1; }
+
+    /// @brief Add `delta` to the value at `i`.
+    constexpr void add(uintptr_t i, T delta) noexcept {
+        for (i++; i < this->tree.size(); i += i & -i)
+            this->tree[i] += delta;
+    }
+
+    /// @brief Sum of the values in [0, i).
+    constexpr T sum(uintptr_t i) const noexcept {
+        auto res = T();
+        for (; i > 0; i -= i & -i)
+            res += this->tree[i];
+        return res;
+    }
+
+    /// @brief Smallest `i` such that `sum(i + 1) > k`, or `size()` if none.
+    /// @warning All values must be non-negative.
+    constexpr uintptr_t find(T k) const noexcept {
+        uintptr_t pos = 0, step = 1;
+        while (step * 2 < this->tree.size())
+            step *= 2;
+        for (; step > 0; step /= 2)
+            if (pos + step < this->tree.size() && this->tree[pos + step] <= k) {
+                pos += step;
+                k -= this->tree[pos];
+            }
+        return pos;
+    }
+};
+
+/// @brief What a search visitor asks the search to do next.
+enum class Flow : uint8_t {
+    /// @brief Go on as usual.
+    Continue,
+    /// @brief Do not go deeper from here, e.g. into the neighbors of a grid
+    /// cell or the extensions of a prefix.
+    Skip,
+    /// @brief Stop the whole search at once.
+    Stop,
+};
+
+/// @brief A vector of at most `N` elements stored inline, which never
+/// allocates.
+/// @tparam T element type
+/// @tparam N capacity
+///
+/// Exceeding `N` panics if `LL_CHECK` is on, and is undefined otherwise.
+template <typename T, uintptr_t N> class Inline final {
+    T buf[N] = {};
+    uintptr_t len = 0;
+
+    static constexpr void check(uintptr_t len) noexcept {
+        if constexpr (LL_CHECK)
+            if (len > N)
+                panic("Inline: capacity exceeded");
+    }
+
+  public:
+    constexpr Inline() noexcept = default;
+
+    /// @brief Create `len` value-initialized elements.
+    constexpr explicit Inline(uintptr_t len) noexcept : len(len) {
+        check(len);
+    }
+
+    /// @brief Copy elements from [first, last).
+    template <typename I> constexpr Inline(I first, I last) noexcept {
+        for (; first != last; ++first) {
+            check(this->len + 1);
+            this->buf[this->len++] = *first;
+        }
+    }
+
+    constexpr Inline(std::initializer_list<T> el) noexcept
+        : Inline(el.begin(), el.end()) {}
+
+    constexpr uintptr_t size() const noexcept { return this->len; }
+    constexpr T* data() noexcept { return this->buf; }
+    constexpr T const* data() const noexcept { return this->buf; }
+    constexpr T& operator[](uintptr_t i) noexcept { return this->buf[i]; }
+    constexpr T const& operator[](uintptr_t i) const noexcept {
+        return this->buf[i];
+    }
+    constexpr T* begin() noexcept { return this->buf; }
+    constexpr T* end() noexcept { return this->buf + this->len; }
+    constexpr T const* begin() const noexcept { return this->buf; }
+    constexpr T const* end() const noexcept { return this->buf + this->len; }
+    constexpr void push_back(T const& value) noexcept {
+        check(this->len + 1);
+        this->buf[this->len++] = value;
+    }
+};
+
 /// @brief An iterator for generating permutations.
+/// @tparam T element type
+/// @tparam Cap if non-zero, the maximum number of elements, so that all
+/// storage is inline and iteration never allocates
 /// @note The implementation internally invokes `std::next_permutation`.
 ///
 /// # Example
@@ -144,173 +686,1662 @@ template <typename T> constexpr Range<T> rng(T term) noexcept {
 /// } // 514 541 154 145 451 415
 ///
 /// ```
-template <typename T = int32_t> class Permut final {
+template <typename T = int32_t, uintptr_t Cap = 0> class Permut final {
   public:
+    /// @brief Storage for a sequence of `U`, inline if `Cap` is non-zero.
+    template <typename U>
+    using Vec = std::conditional_t<Cap == 0, std::vector<U>, Inline<U, Cap>>;
+
     /// @brief Elements of the permutation.
-    std::vector<T> const el;
-    constexpr Permut(std::vector<T> el) noexcept : el(el) {}
-    constexpr int32_t cnt() const noexcept { return fact(el.size()); }
+    Vec<T> const el;
+    constexpr Permut(std::vector<T> el) noexcept
+        : el(Vec<T>(el.begin(), el.end())) {}
+    constexpr Permut(std::initializer_list<T> el) noexcept
+        : el(Vec<T>(el.begin(), el.end())) {}
+    /// @brief Number of permutations, `el.size()!`.
+    /// @tparam R result type, `uint64_t` for up to 20 elements or `int128_t`
+    /// for up to 33
+    template <typename R = uint64_t> constexpr R cnt() const noexcept {
+        return fact<R>(el.size());
+    }
+
+    /// @brief A permutation of `el` borrowed from an iterator. It is only
+    /// valid until the iterator advances.
+    class View final {
+        Vec<T> const* el;
+        uintptr_t const* idx;
+
+      public:
+        constexpr View(Vec<T> const* el, uintptr_t const* idx) noexcept
+            : el(el), idx(idx) {}
+        constexpr uintptr_t size() const noexcept { return this->el->size(); }
+        constexpr T const& operator[](uintptr_t i) const noexcept {
+            return (*this->el)[this->idx[i]];
+        }
+        /// @brief Positions in `el` of the elements, in order.
+        constexpr uintptr_t const* index() const noexcept { return this->idx; }
+        /// @brief Random access iterator over the elements of a view.
+        class Iterator final {
+            View const* view;
+            uintptr_t i;
+
+          public:
+            using iterator_category = std::random_access_iterator_tag;
+            using value_type = T;
+            using difference_type = intptr_t;
+            using pointer = T const*;
+            using reference = T const&;
+
+            constexpr Iterator() noexcept : view(nullptr), i(0) {}
+            constexpr Iterator(View const* view, uintptr_t i) noexcept
+                : view(view), i(i) {}
+            constexpr T const& operator*() const noexcept {
+                return (*this->view)[this->i];
+            }
+            constexpr T const* operator->() const noexcept {
+                return &**this;
+            }
+            constexpr T const& operator[](intptr_t n) const noexcept {
+                return (*this->view)[this->i + n];
+            }
+            constexpr Iterator& operator++() noexcept {
+                ++this->i;
+                return *this;
+            }
+            constexpr Iterator& operator--() noexcept {
+                --this->i;
+                return *this;
+            }
+            constexpr Iterator operator++(int) noexcept {
+                auto res = *this;
+                ++this->i;
+                return res;
+            }
+            constexpr Iterator operator--(int) noexcept {
+                auto res = *this;
+                --this->i;
+                return res;
+            }
+            constexpr Iterator& operator+=(intptr_t n) noexcept {
+                this->i += n;
+                return *this;
+            }
+            constexpr Iterator& operator-=(intptr_t n) noexcept {
+                this->i -= n;
+                return *this;
+            }
+            constexpr Iterator operator+(intptr_t n) const noexcept {
+                return Iterator(this->view, this->i + n);
+            }
+            constexpr Iterator operator-(intptr_t n) const noexcept {
+                return Iterator(this->view, this->i - n);
+            }
+            friend constexpr Iterator operator+(intptr_t n,
+                                                Iterator const& it) noexcept {
+                return it + n;
+            }
+            constexpr intptr_t operator-(Iterator const& rhs) const noexcept {
+                return intptr_t(this->i - rhs.i);
+            }
+            constexpr bool operator==(Iterator const& rhs) const noexcept {
+                return this->i == rhs.i;
+            }
+            constexpr bool operator!=(Iterator const& rhs) const noexcept {
+                return this->i != rhs.i;
+            }
+            constexpr bool operator<(Iterator const& rhs) const noexcept {
+                return this->i < rhs.i;
+            }
+            constexpr bool operator>(Iterator const& rhs) const noexcept {
+                return this->i > rhs.i;
+            }
+            constexpr bool operator<=(Iterator const& rhs) const noexcept {
+                return this->i <= rhs.i;
+            }
+            constexpr bool operator>=(Iterator const& rhs) const noexcept {
+                return this->i >= rhs.i;
+            }
+        };
+        constexpr Iterator begin() const noexcept { return Iterator(this, 0); }
+        constexpr Iterator end() const noexcept {
+            return Iterator(this, this->size());
+        }
+        inline operator std::vector<T>() const {
+            auto res = std::vector<T>();
+            res.reserve(this->size());
+            for (auto& i : *this)
+                res.push_back(i);
+            return res;
+        }
+    };
+
     class Iterator final {
       public:
-        std::vector<T> const& el;
+        Vec<T> const& el;
 
       private:
-        std::vector<uintptr_t> curr;
-        std::vector<T> buf;
+        Vec<uintptr_t> curr;
         bool next = true;
+        /// @brief The view handed out by `operator*`, re-pointed at `curr` on
+        /// each dereference since copies of the iterator move `curr`.
+        mutable View view = View(nullptr, nullptr);
 
       public:
-        constexpr Iterator(std::vector<T> const& el)
-            : el(el), curr(std::vector<uintptr_t>(el.size())),
-              buf(std::vector<T>(el.size())) {
-            for (auto i : rng(el.size())) {
+        constexpr Iterator(Vec<T> const& el)
+            : el(el), curr(Vec<uintptr_t>(el.size())) {
+            for (auto i : rng(el.size()))
                 this->curr[i] = i;
-                this->buf[i] = el[curr[i]];
-            }
         }
-        constexpr std::vector<T> const& operator*() const noexcept {
-            return this->buf;
+
+        /// @brief Create an iterator at the index permutation `curr`.
+        constexpr Iterator(Vec<T> const& el, Vec<uintptr_t> curr)
+            : el(el), curr(std::move(curr)) {}
+
+        /// @brief Lexicographic rank of the current permutation.
+        template <typename R = uint64_t> constexpr R rank() const noexcept {
+            return Permut::rank<R>(this->curr);
+        }
+        constexpr View const& operator*() const noexcept {
+            this->view = View(&this->el, this->curr.data());
+            return this->view;
         }
         constexpr Iterator& operator++() noexcept {
             this->next =
                 std::next_permutation(this->curr.begin(), this->curr.end());
-            for (auto i : rng(this->el.size()))
-                this->buf[i] = this->el[curr[i]];
             return *this;
         }
-        constexpr bool operator!=(Iterator const& _) const noexcept {
+        constexpr bool operator!=(Sentinel) const noexcept {
             return this->next;
         }
     };
 
     constexpr Iterator begin() const noexcept { return Iterator(this->el); }
-    constexpr Iterator end() const noexcept { return Iterator(this->el); }
-};
-
-// template<int W = 1024, int H = 1024>
-class Grid final {
-  private:
-    static constexpr uintptr_t W = 1024, H = 1024;
-    using T = char;
-    static inline T MAP[W][H];
-    static inline std::vector<bool> DONE = std::vector(W * H, false);
-
-  public:
-    static inline uintptr_t WIDTH = W, HEIGHT = H;
-
-    /// @brief Set the width and height of the grid.
-    /// @param width width, or the first index of array
-    /// @param height height, or the second index of array
-    static constexpr void set(uintptr_t width, uintptr_t height) noexcept {
-        WIDTH = width;
-        HEIGHT = height;
-    }
-
-    /// @brief Initialize the grid reading input from `input`
-    /// @param input the stream to read
-    static inline void init(std::istream& input) noexcept {
-        for (auto y : rng(HEIGHT))
-            for (auto x : rng(WIDTH))
-                input >> MAP[x][y];
-    }
+    constexpr Sentinel end() const noexcept { return Sentinel(); }
 
-    /// @brief Output the grid to `output`
-    /// @param output the stream to write to
-    static inline void output(std::ostream& output) noexcept {
-        for (auto y : rng(HEIGHT)) {
-            for (auto x : rng(WIDTH))
-                output << MAP[x][y];
-            output << std::endl;
+    /// @brief Lexicographic rank of an index permutation, in O(n log n).
+    /// @tparam R rank type, `uint64_t` for n up to 20 or `int128_t` for n up
+    /// to 33
+    /// @param p a permutation of [0, n), indexable with `size()`
+    /// @return the number of permutations of [0, n) less than `p`
+    template <typename R = uint64_t, typename P>
+    static constexpr R rank(P const& p) {
+        auto n = p.size();
+        auto used = Fenwick<uint32_t>(n);
+        auto res = R();
+        for (uintptr_t i = 0; i < n; i++) {
+            res = res * R(n - i) + R(p[i] - used.sum(p[i]));
+            used.add(p[i], 1);
         }
+        return res;
     }
 
-    /// @brief Pretty print the grid to `stderr`.
-    static inline void debug() noexcept {
-        std::cerr << std::endl << "┌";
-        for (auto _ : rng(WIDTH))
-            std::cerr << "─";
-        std::cerr << WIDTH << std::endl;
-        for (auto y : rng(HEIGHT)) {
-            std::cerr << "│";
-            for (auto x : rng(WIDTH))
-                std::cerr << MAP[x][y];
-            std::cerr << std::endl;
+    /// @brief The index permutation of lexicographic rank `k`, in
+    /// O(n log n). This inverts `rank`.
+    /// @tparam R rank type, see `rank`
+    /// @param k the rank, in [0, n!)
+    /// @return a permutation of [0, el.size())
+    template <typename R = uint64_t>
+    constexpr Vec<uintptr_t> unrank(R k) const {
+        auto n = this->el.size();
+        auto res = Vec<uintptr_t>(n);
+        for (uintptr_t j = 1; j <= n; j++) {
+            res[n - j] = uintptr_t(k % R(j));
+            k /= R(j);
         }
-        std::cerr << HEIGHT << std::endl << std::endl;
+        auto free = Fenwick<uint32_t>(n, 1);
+        for (auto& d : res) {
+            d = free.find(d);
+            free.add(d, -1);
+        }
+        return res;
     }
 
-    /// @brief Reset all `.done()` flags.
-    static constexpr void refresh() noexcept {
-        DONE.assign(DONE.size(), false);
+    /// @brief Iterator starting at the permutation of lexicographic rank `k`,
+    /// to be compared against `end()`.
+    /// @param k the rank, in [0, n!)
+    template <typename R = uint64_t> constexpr Iterator seek(R k) const {
+        return Iterator(this->el, this->unrank(k));
     }
 
-    /// @brief x-coordinate of the cell.
-    uintptr_t const x;
+    /// @brief Single-pass range over the permutations of `el` in the order of
+    /// Heap's algorithm, where each step applies exactly one swap. Obtained
+    /// from `Permut::heap()`.
+    ///
+    /// # Example
+    ///
+    /// ```cpp
+    ///
+    /// auto h = ll::Permut<int>({5, 1, 4}).heap();
+    ///
+    /// for (auto& p : h) {
+    ///
+    ///     auto [i, j] = h.changed(); // update costs touching p[i], p[j]
+    ///
+    /// }
+    ///
+    /// ```
+    class Heap final {
+        Vec<T> buf;
+        /// @brief Loop counters of the iterative Heap's algorithm.
+        Vec<uintptr_t> c;
+        uintptr_t i = 1;
+        std::pair<uintptr_t, uintptr_t> last = {0, 0};
+        bool more = true;
 
-    /// @brief y-coordinate of the cell.
-    uintptr_t const y;
+      public:
+        constexpr Heap(Vec<T> const& el)
+            : buf(el), c(Vec<uintptr_t>(el.size())) {}
 
-    /// @brief Create an always-invalid cell.
-    constexpr Grid() noexcept : x(-1), y(-1) {}
+        /// @brief The current permutation.
+        constexpr Vec<T> const& get() const noexcept { return this->buf; }
 
-    /// @brief Create a cell with specified coordinates.
-    /// @param x x-coordinate of the cell
-    /// @param y y-coordinate of the cell
-    constexpr Grid(uintptr_t x, uintptr_t y) noexcept : x(x), y(y) {}
+        /// @brief Positions swapped by the last step, or (0, 0) before the
+        /// first step.
+        constexpr std::pair<uintptr_t, uintptr_t> changed() const noexcept {
+            return this->last;
+        }
 
-    /// @brief Calculate new `Grid` with difference `dx` in x coordinate.
-    /// @param dx difference in x
-    /// @return the translated cell
-    constexpr Grid dx(intptr_t dx) const noexcept {
-        return Grid(this->x + dx, this->y);
-    }
+        /// @brief Step to the next permutation with one swap.
+        /// @return whether there was a next permutation
+        constexpr bool next() noexcept {
+            for (; this->i < this->buf.size(); this->i++) {
+                auto& ci = this->c[this->i];
+                if (ci < this->i) {
+                    auto j = this->i % 2 == 0 ? 0 : ci;
+                    std::swap(this->buf[j], this->buf[this->i]);
+                    this->last = {j, this->i};
+                    ci++;
+                    this->i = 1;
+                    return true;
+                }
+                ci = 0;
+            }
+            return this->more = false;
+        }
 
-    /// @brief Calculate new `Grid` with difference `dy` in y coordinate.
-    /// @param dy difference in y
-    /// @return the translated cell
-    constexpr Grid dy(intptr_t dy) const noexcept {
-        return Grid(this->x, this->y + dy);
-    }
+        class Iterator final {
+            Heap* heap;
 
-    /// @brief Check whether two `Grid`s indicates the same position.
-    /// @param rhs right-hand side of operator
-    /// @return result of equivalance operator
-    constexpr bool operator==(Grid rhs) const noexcept {
-        return this->x == rhs.x && this->y == rhs.y;
+          public:
+            constexpr Iterator(Heap* heap) noexcept : heap(heap) {}
+            constexpr Vec<T> const& operator*() const noexcept {
+                return this->heap->buf;
+            }
+            constexpr Iterator& operator++() noexcept {
+                this->heap->next();
+                return *this;
+            }
+            constexpr bool operator!=(Sentinel) const noexcept {
+                return this->heap->more;
+            }
+        };
+        constexpr Iterator begin() noexcept { return Iterator(this); }
+        constexpr Sentinel end() noexcept { return Sentinel(); }
     };
 
-    /// @brief Whether this `Grid` cell indicates a valid position in the grid.
-    /// @return result of check
-    constexpr bool valid() const noexcept {
-        return x >= 0 && x < WIDTH && y >= 0 && y < HEIGHT;
-    }
+    /// @brief Permutations of `el` in the order of Heap's algorithm.
+    /// @return a single-pass range, see `Heap`
+    constexpr Heap heap() const { return Heap(this->el); }
 
-    /// @brief Visit the content in specified position.
-    /// @return reference to content
-    /// @warning This does not perform any boundary check.
-    constexpr T& tile() const noexcept { return MAP[this->x][this->y]; }
+    /// @brief Single-pass range over the permutations of at most 16 elements
+    /// in lexicographic order, keeping the index permutation as one byte per
+    /// slot of a 16-byte array. Obtained from `Permut::packed()`.
+    ///
+    /// # Example
+    ///
+    /// ```cpp
+    ///
+    /// auto seen = std::unordered_set<uint64_t>();
+    ///
+    /// for (auto& p : ll::Permut<int>({5, 1, 4}).packed())
+    ///
+    ///     seen.insert(p.key());
+    ///
+    /// ```
+    class Packed final {
+        Vec<T> el;
+        alignas(16) uint8_t idx[16] = {};
+        bool more = true;
 
-    /// @brief Output the `Grid` cell in the format "(x, y)".
-    /// @param output the stream to output to
-    /// @param cell the instatnce to output
-    /// @return `output` for chaining
-    friend constexpr std::ostream& operator<<(std::ostream& output,
-                                              Grid cell) noexcept {
-        return output << "(" << cell.x << "," << cell.y << ")";
-    }
+      public:
+        inline Packed(Vec<T> const& el) : el(el) {
+            if (el.size() > 16)
+                panic("packed: more than 16 elements");
+            for (uintptr_t i = 0; i < el.size(); i++)
+                this->idx[i] = uint8_t(i);
+        }
 
-    /// @brief Flag that indicates whether a cell has been processed.
-    /// @return reference to flag
-    inline std::vector<bool>::reference done() const noexcept {
-        return DONE[this->y * WIDTH + this->x];
-    }
+        constexpr uintptr_t size() const noexcept { return this->el.size(); }
+        constexpr T const& operator[](uintptr_t i) const noexcept {
+            return this->el[this->idx[i]];
+        }
+        /// @brief Positions in `el` of the elements, in order.
+        constexpr uint8_t const* index() const noexcept { return this->idx; }
 
-    /// @brief Gets the neighboring cells (if valid) of the given cell.
-    /// @return list of cells
-    /// @todo constexpr when c++23
-    inline std::vector<Grid> neighbor() const noexcept {
-        auto res = std::vector<Grid>();
-        for (auto cell : {this->dy(1), this->dx(1), this->dx(-1), this->dy(-1)})
+        /// @brief The index permutation as 16 4-bit digits, the first one
+        /// most significant and unused ones zero. Keys are unique, and
+        /// ordered like the permutations.
+        inline uint64_t key() const noexcept {
+            uint64_t half[2];
+            std::memcpy(half, this->idx, 16);
+            for (auto& h : half) {
+                // gather the low nibble of each byte, first byte highest
+                h = __builtin_bswap64(h);
+                h = (h | h >> 4) & 0x00ff00ff00ff00ff;
+                h = (h | h >> 8) & 0x0000ffff0000ffff;
+                h = (h | h >> 16) & 0x00000000ffffffff;
+            }
+            return half[0] << 32 | half[1];
+        }
+
+        /// @brief Step to the next permutation in lexicographic order.
+        /// @return whether there was a next permutation
+        inline bool next() noexcept {
+            return this->more = std::next_permutation(
+                       this->idx, this->idx + this->size());
+        }
+
+        class Iterator final {
+            Packed* packed;
+
+          public:
+            constexpr Iterator(Packed* packed) noexcept : packed(packed) {}
+            constexpr Packed const& operator*() const noexcept {
+                return *this->packed;
+            }
+            inline Iterator& operator++() noexcept {
+                this->packed->next();
+                return *this;
+            }
+            constexpr bool operator!=(Sentinel) const noexcept {
+                return this->packed->more;
+            }
+        };
+        constexpr Iterator begin() noexcept { return Iterator(this); }
+        constexpr Sentinel end() noexcept { return Sentinel(); }
+    };
+
+    /// @brief Permutations of at most 16 elements with packed byte state.
+    /// @return a single-pass range, see `Packed`
+    inline Packed packed() const { return Packed(this->el); }
+};
+
+/// @brief Visit every permutation of `el` on worker threads, each folding
+/// into its own accumulator, merged at the end.
+/// @param el elements of the permutation
+/// @param threads number of worker threads, or 0 for the hardware
+/// concurrency
+/// @param init the initial accumulator of every thread
+/// @param visitor the function taking a thread's accumulator by reference
+/// and a `Permut<T>::View`
+/// @param merge the function taking two accumulators and returning the
+/// merged one
+/// @return the merge of all accumulators
+///
+/// The rank range [0, n!) is split into one contiguous range per thread. Each
+/// thread unranks its start and steps locally, so the visiting order inside a
+/// range is lexicographic. `el` must have at most 20 elements.
+///
+/// # Example
+///
+/// ```cpp
+///
+/// auto best = ll::parallel_permut(el, 0, INT64_MAX,
+///
+///     [&](int64_t& acc, auto p) { acc = std::min(acc, cost(p)); },
+///
+///     [](int64_t a, int64_t b) { return std::min(a, b); });
+///
+/// ```
+template <typename T, typename A, typename F, typename M>
+inline A parallel_permut(std::vector<T> const& el, uintptr_t threads, A init,
+                         F visitor, M merge) {
+    if (threads == 0)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    auto perm = Permut<T>(el);
+    auto total = fact<uint64_t>(el.size());
+    threads = std::min<uint64_t>(threads, total);
+    // a wrapper keeps `std::vector<bool>` from packing the results into
+    // shared words, and the alignment keeps threads off each other's lines
+    struct alignas(64) Slot {
+        A value;
+    };
+    auto acc = std::vector<Slot>(threads, Slot{init});
+    auto worker = [&](uintptr_t t) {
+        auto q = total / threads, r = total % threads;
+        auto begin = q * t + std::min<uint64_t>(t, r), count = q + (t < r);
+        auto local = init;
+        auto it = perm.seek(begin);
+        for (uint64_t i = 0; i < count; i++, ++it)
+            visitor(local, *it);
+        acc[t].value = std::move(local);
+    };
+    auto pool = std::vector<std::thread>();
+    for (auto t : rng<uintptr_t>(1, threads))
+        pool.emplace_back(worker, t);
+    worker(0);
+    for (auto& t : pool)
+        t.join();
+    auto res = std::move(acc[0].value);
+    for (auto t : rng<uintptr_t>(1, threads))
+        res = merge(std::move(res), std::move(acc[t].value));
+    return res;
+}
+
+/// @brief Visit every permutation of `el` on worker threads. See the
+/// reducing overload.
+/// @param visitor the function taking a `Permut<T>::View`, which must be safe
+/// to call concurrently
+template <typename T, typename F>
+inline void parallel_permut(std::vector<T> const& el, uintptr_t threads,
+                            F visitor) {
+    struct None {};
+    parallel_permut(
+        el, threads, None(), [&](None&, auto p) { visitor(p); },
+        [](None, None) { return None(); });
+}
+
+/// @brief An iterator for generating the distinct permutations of a multiset,
+/// in lexicographic order.
+/// @tparam T element type, ordered by `<`
+/// @tparam Cap if non-zero, the maximum number of elements, so that all
+/// storage is inline
+///
+/// Unlike `Permut`, equal elements are interchangeable, so each distinct
+/// arrangement is visited exactly once.
+///
+/// # Example
+///
+/// ```cpp
+///
+/// for (auto& p : ll::MultiPermut<int>({1, 2, 1})) {
+///
+///     for (auto i : p) std::cout << i;
+///
+///     std::cout << " ";
+///
+/// } // 112 121 211
+///
+/// ```
+template <typename T = int32_t, uintptr_t Cap = 0> class MultiPermut final {
+  public:
+    template <typename U> using Vec = typename Permut<U, Cap>::template Vec<U>;
+
+    /// @brief Elements of the multiset, sorted.
+    Vec<T> const el;
+
+    constexpr MultiPermut(std::vector<T> el) noexcept
+        : el(sorted(Vec<T>(el.begin(), el.end()))) {}
+    constexpr MultiPermut(std::initializer_list<T> el) noexcept
+        : el(sorted(Vec<T>(el.begin(), el.end()))) {}
+
+    /// @brief Number of distinct permutations, the multinomial coefficient
+    /// n! / (m1! m2! ...) over the multiplicities m of equal elements.
+    /// @warning The result must fit in `uint64_t`.
+    constexpr uint64_t cnt() const noexcept {
+        uint64_t res = 1;
+        uintptr_t n = 0, m = 0;
+        for (uintptr_t i = 0; i < this->el.size(); i++) {
+            m = i > 0 && !(this->el[i - 1] < this->el[i]) ? m + 1 : 1;
+            n++;
+            // the m-th copy of a value among n elements scales it by n / m
+            res = uint64_t(int128_t(res) * n / m);
+        }
+        return res;
+    }
+
+    class Iterator final {
+        Vec<T> buf;
+        bool next = true;
+
+      public:
+        constexpr Iterator(Vec<T> const& el) : buf(el) {}
+        constexpr Vec<T> const& operator*() const noexcept {
+            return this->buf;
+        }
+        constexpr Iterator& operator++() noexcept {
+            this->next = std::next_permutation(this->buf.begin(),
+                                               this->buf.end());
+            return *this;
+        }
+        constexpr bool operator!=(Sentinel) const noexcept {
+            return this->next;
+        }
+    };
+
+    constexpr Iterator begin() const noexcept { return Iterator(this->el); }
+    constexpr Sentinel end() const noexcept { return Sentinel(); }
+
+  private:
+    static constexpr Vec<T> sorted(Vec<T> el) noexcept {
+        std::sort(el.begin(), el.end());
+        return el;
+    }
+};
+
+/// @brief A permutation of [0, n) as a value, mapping `i` to `p[i]`.
+/// @tparam I index type, e.g. `uint8_t` for small permutations
+///
+/// Composition follows function composition, `(a * b)[i] == a[b[i]]`, so
+/// that `p.apply(v)` gathers `v[p[i]]` and applying `p` k times is the same
+/// as applying `p.pow(k)` once.
+///
+/// # Example
+///
+/// ```cpp
+///
+/// auto p = ll::Perm<uint8_t>({1, 2, 0, 4, 3});
+///
+/// p.order(); // 6
+///
+/// p.pow(1000000000000000000) == p.pow(4); // true
+///
+/// ```
+template <typename I = uint32_t> class Perm final {
+    static_assert(std::is_unsigned_v<I>, "index type must be unsigned");
+    std::vector<I> p;
+
+  public:
+    /// @brief Create the identity permutation of size `n`.
+    explicit Perm(uintptr_t n = 0) : p(n) {
+        for (uintptr_t i = 0; i < n; i++)
+            this->p[i] = I(i);
+    }
+
+    /// @brief Create from the images of [0, n).
+    /// @warning `p` must be a permutation of [0, n).
+    Perm(std::vector<I> p) : p(std::move(p)) {}
+    Perm(std::initializer_list<I> p) : p(p) {}
+
+    inline uintptr_t size() const noexcept { return this->p.size(); }
+    inline I operator[](uintptr_t i) const noexcept { return this->p[i]; }
+    inline std::vector<I> const& vec() const noexcept { return this->p; }
+    inline bool operator==(Perm const& other) const noexcept {
+        return this->p == other.p;
+    }
+    inline bool operator!=(Perm const& other) const noexcept {
+        return this->p != other.p;
+    }
+
+    /// @brief Composition, applying `other` first.
+    /// @warning Both permutations must have the same size.
+    inline Perm operator*(Perm const& other) const {
+        auto n = this->size();
+        auto res = Perm(std::vector<I>(n));
+        for (uintptr_t i = 0; i < n; i++)
+            res.p[i] = this->p[other.p[i]];
+        return res;
+    }
+
+    inline Perm& operator*=(Perm const& other) {
+        return *this = *this * other;
+    }
+
+    /// @brief The inverse permutation.
+    inline Perm inverse() const {
+        auto res = Perm(std::vector<I>(this->size()));
+        for (uintptr_t i = 0; i < this->size(); i++)
+            res.p[this->p[i]] = I(i);
+        return res;
+    }
+
+    /// @brief Gather `v[p[i]]` for every `i`.
+    template <typename T>
+    inline std::vector<T> apply(std::vector<T> const& v) const {
+        std::vector<T> res;
+        res.reserve(this->size());
+        for (auto i : this->p)
+            res.push_back(v[i]);
+        return res;
+    }
+
+    /// @brief Decompose into disjoint cycles, each starting from its smallest
+    /// element, in increasing order of that element. Fixed points are
+    /// included as cycles of length 1.
+    inline std::vector<std::vector<I>> cycles() const {
+        std::vector<std::vector<I>> res;
+        std::vector<bool> seen(this->size());
+        for (uintptr_t i = 0; i < this->size(); i++) {
+            if (seen[i])
+                continue;
+            auto& cycle = res.emplace_back();
+            for (auto j = I(i); !seen[j]; j = this->p[j]) {
+                seen[j] = true;
+                cycle.push_back(j);
+            }
+        }
+        return res;
+    }
+
+    /// @brief The smallest positive k such that `pow(k)` is the identity,
+    /// i.e. the LCM of the cycle lengths.
+    /// @warning The result must fit in `R`.
+    template <typename R = uint64_t> inline R order() const {
+        R res = 1;
+        for (auto const& cycle : this->cycles()) {
+            R len = cycle.size();
+            R a = res, b = len;
+            while (b != 0)
+                a %= b, std::swap(a, b);
+            res = res / a * len;
+        }
+        return res;
+    }
+
+    /// @brief Apply the permutation `k` times, in O(n) by rotating each
+    /// cycle by `k` modulo its length.
+    template <typename K> inline Perm pow(K k) const {
+        static_assert(std::is_integral_v<K> || std::is_same_v<K, int128_t>,
+                      "exponent must be an integer");
+        auto res = Perm(std::vector<I>(this->size()));
+        for (auto const& cycle : this->cycles()) {
+            auto len = cycle.size();
+            // reduce in a wide type, as `len` may not fit in `K`
+            auto w = int128_t(k) % int128_t(len);
+            // negative exponents rotate the other way
+            if (w < 0)
+                w += len;
+            auto r = uintptr_t(w);
+            for (uintptr_t j = 0, t = r; j < len; j++) {
+                res.p[cycle[j]] = cycle[t];
+                if (++t == len)
+                    t = 0;
+            }
+        }
+        return res;
+    }
+};
+
+/// @brief Count the pairs i < j with `range[j] < range[i]`, by a bottom-up
+/// merge sort in O(n log n).
+/// @tparam R count type, `int128_t` for ranges beyond ~6e9 elements
+/// @param range any range with `begin()` and `end()`, e.g. a vector or a
+/// `Permut` view
+template <typename R = uint64_t, typename C>
+inline R inversions(C const& range) {
+    using T = std::decay_t<decltype(*std::begin(range))>;
+    auto a = std::vector<T>();
+    for (auto const& x : range)
+        a.push_back(x);
+    auto b = std::vector<T>(a.size());
+    auto n = a.size();
+    R res = 0;
+    for (uintptr_t w = 1; w < n; w *= 2) {
+        for (uintptr_t lo = 0; lo < n; lo += 2 * w) {
+            auto mid = std::min(lo + w, n), hi = std::min(lo + 2 * w, n);
+            uintptr_t i = lo, j = mid, k = lo;
+            while (i < mid && j < hi)
+                if (a[j] < a[i])
+                    res += R(mid - i), b[k++] = a[j++];
+                else
+                    b[k++] = a[i++];
+            while (i < mid)
+                b[k++] = a[i++];
+            while (j < hi)
+                b[k++] = a[j++];
+        }
+        std::swap(a, b);
+    }
+    return res;
+}
+
+/// @brief Parity of the inversion count of `range`, true if odd.
+///
+/// A permutation of [0, n) with c cycles has parity n - c, which is counted
+/// in O(n). Other ranges are first replaced by the ranks of their elements,
+/// with ties broken by position, in O(n log n).
+template <typename C> inline bool parity(C const& range) {
+    using T = std::decay_t<decltype(*std::begin(range))>;
+    auto v = std::vector<T>();
+    for (auto const& x : range)
+        v.push_back(x);
+    auto n = v.size();
+    auto p = std::vector<uintptr_t>(n);
+    auto seen = std::vector<bool>(n);
+    auto is_perm = false;
+    if constexpr (std::is_integral_v<T>) {
+        is_perm = true;
+        for (uintptr_t i = 0; i < n && is_perm; i++) {
+            p[i] = uintptr_t(v[i]);
+            is_perm = p[i] < n && !seen[p[i]];
+            if (is_perm)
+                seen[p[i]] = true;
+        }
+    }
+    if (!is_perm) {
+        auto order = std::vector<uintptr_t>(n);
+        for (uintptr_t i = 0; i < n; i++)
+            order[i] = i;
+        std::stable_sort(order.begin(), order.end(),
+                         [&](auto i, auto j) { return v[i] < v[j]; });
+        for (uintptr_t r = 0; r < n; r++)
+            p[order[r]] = r;
+    }
+    seen.assign(n, false);
+    auto odd = false;
+    for (uintptr_t i = 0; i < n; i++)
+        for (auto j = p[i]; !seen[j]; j = p[j])
+            seen[j] = true, odd ^= j != i;
+    return odd;
+}
+
+/// @brief Parity of a permutation, true if odd, by counting cycles.
+template <typename I> inline bool parity(Perm<I> const& p) {
+    return parity(p.vec());
+}
+
+/// @brief The SplitMix64 generator, mostly for seeding `Xoshiro`.
+class SplitMix final {
+    uint64_t state;
+
+  public:
+    using result_type = uint64_t;
+    static constexpr uint64_t min() noexcept { return 0; }
+    static constexpr uint64_t max() noexcept { return UINT64_MAX; }
+
+    constexpr explicit SplitMix(uint64_t seed) noexcept : state(seed) {}
+    constexpr uint64_t operator()() noexcept {
+        auto z = this->state += 0x9e3779b97f4a7c15;
+        z = (z ^ z >> 30) * 0xbf58476d1ce4e5b9;
+        z = (z ^ z >> 27) * 0x94d049bb133111eb;
+        return z ^ z >> 31;
+    }
+};
+
+/// @brief The xoshiro256** generator, a fast 64-bit generator meeting the
+/// requirements of `std::uniform_random_bit_generator`.
+class Xoshiro final {
+    uint64_t s[4];
+
+    static constexpr uint64_t rotl(uint64_t x, int k) noexcept {
+        return x << k | x >> (64 - k);
+    }
+
+  public:
+    using result_type = uint64_t;
+    static constexpr uint64_t min() noexcept { return 0; }
+    static constexpr uint64_t max() noexcept { return UINT64_MAX; }
+
+    /// @brief Seed the state from `SplitMix(seed)`.
+    constexpr explicit Xoshiro(uint64_t seed = 0) noexcept : s() {
+        auto mix = SplitMix(seed);
+        for (auto& x : this->s)
+            x = mix();
+    }
+    constexpr uint64_t operator()() noexcept {
+        auto res = rotl(this->s[1] * 5, 7) * 9;
+        auto t = this->s[1] << 17;
+        this->s[2] ^= this->s[0];
+        this->s[3] ^= this->s[1];
+        this->s[1] ^= this->s[2];
+        this->s[0] ^= this->s[3];
+        this->s[2] ^= t;
+        this->s[3] = rotl(this->s[3], 45);
+        return res;
+    }
+};
+
+/// @brief A uniform integer in [0, n) by Lemire's nearly divisionless
+/// method, which divides only when the multiply lands in the biased range.
+/// @param rng a generator of uniform 64-bit values, e.g. `Xoshiro`
+/// @param n the bound, positive
+template <typename G> constexpr uint64_t bounded(G& rng, uint64_t n) {
+    static_assert(G::min() == 0 && G::max() == UINT64_MAX,
+                  "generator must produce 64 bits");
+    auto m = uint128_t(rng()) * n;
+    if (uint64_t(m) < n) {
+        auto t = -n % n;
+        while (uint64_t(m) < t)
+            m = uint128_t(rng()) * n;
+    }
+    return uint64_t(m >> 64);
+}
+
+/// @brief Shuffle [first, first + n) uniformly by Fisher-Yates. Two swap
+/// positions are drawn from each 64-bit value as long as the product of
+/// their bounds fits, following Brackett-Rozinsky and Lemire.
+template <typename T, typename G>
+inline void shuffle(T* first, uintptr_t n, G& rng) {
+    auto i = n;
+    for (; i > 2 && uint128_t(i) * (i - 1) <= UINT64_MAX; i -= 2) {
+        uint64_t a = i, b = i - 1, prod = a * b;
+        auto x = uint128_t(rng()) * a;
+        auto y = uint128_t(uint64_t(x)) * b;
+        if (uint64_t(y) < prod) {
+            auto t = -prod % prod;
+            while (uint64_t(y) < t) {
+                x = uint128_t(rng()) * a;
+                y = uint128_t(uint64_t(x)) * b;
+            }
+        }
+        std::swap(first[i - 1], first[uint64_t(x >> 64)]);
+        std::swap(first[i - 2], first[uint64_t(y >> 64)]);
+    }
+    for (; i > 1; i--)
+        std::swap(first[i - 1], first[bounded(rng, i)]);
+}
+
+/// @brief A uniformly random permutation of [0, n).
+/// @param rng a generator of uniform 64-bit values, e.g. `Xoshiro`
+///
+/// # Example
+///
+/// ```cpp
+///
+/// auto rng = ll::Xoshiro(42);
+///
+/// auto p = ll::random_permut(10, rng);
+///
+/// ```
+template <typename I = uint32_t, typename G>
+inline Perm<I> random_permut(uintptr_t n, G& rng) {
+    auto res = std::vector<I>(n);
+    for (uintptr_t i = 0; i < n; i++)
+        res[i] = I(i);
+    shuffle(res.data(), n, rng);
+    return Perm<I>(std::move(res));
+}
+
+/// @brief `cnt` independent random permutations of [0, n), stored
+/// contiguously, the k-th one at [k * n, (k + 1) * n).
+template <typename I = uint32_t, typename G>
+inline std::vector<I> random_permuts(uintptr_t n, uintptr_t cnt, G& rng) {
+    auto res = std::vector<I>(n * cnt);
+    if (n == 0 || cnt == 0)
+        return res;
+    for (uintptr_t i = 0; i < n; i++)
+        res[i] = I(i);
+    for (uintptr_t k = 1; k < cnt; k++)
+        std::memcpy(res.data() + k * n, res.data(), n * sizeof(I));
+    for (uintptr_t k = 0; k < cnt; k++)
+        shuffle(res.data() + k * n, n, rng);
+    return res;
+}
+
+/// @brief An iterator for generating the k-subsets of [0, n).
+///
+/// Iterating a `Comb` directly yields each subset as a 64-bit mask in
+/// increasing order, stepping by Gosper's hack, which requires `n <= 64`. For
+/// larger `n` the mask range panics if `LL_CHECK` is on, and is empty
+/// otherwise; use `indices()` instead.
+/// `indices()` yields sorted index arrays in lexicographic order for any `n`,
+/// and `revolving()` yields them in revolving-door order, where each step
+/// swaps exactly one element out and one in.
+///
+/// # Example
+///
+/// ```cpp
+///
+/// for (auto mask : ll::Comb(4, 2)) std::cout << mask << " ";
+///
+/// // 3 5 6 9 10 12
+///
+/// ```
+class Comb final {
+  public:
+    /// @brief Size of the ground set.
+    uintptr_t const n;
+    /// @brief Size of each subset.
+    uintptr_t const k;
+
+    constexpr Comb(uintptr_t n, uintptr_t k) noexcept : n(n), k(k) {}
+
+    /// @brief Number of subsets, the binomial coefficient C(n, k).
+    /// @warning The result must fit in `uint64_t`.
+    constexpr uint64_t cnt() const noexcept {
+        if (this->k > this->n)
+            return 0;
+        uint64_t res = 1;
+        for (uintptr_t i = 1; i <= this->k; i++)
+            res = uint64_t(int128_t(res) * (this->n - this->k + i) / i);
+        return res;
+    }
+
+    class Iterator final {
+        uint64_t mask;
+        uintptr_t n;
+        bool next;
+
+      public:
+        constexpr Iterator(uintptr_t n, uintptr_t k) noexcept
+            : mask(k == 0 || k > n || n > 64 ? 0 : ~uint64_t(0) >> (64 - k)),
+              n(n), next(k <= n && n <= 64) {
+            if constexpr (LL_CHECK)
+                if (n > 64)
+                    panic("Comb: more than 64 elements, use indices()");
+        }
+        constexpr uint64_t operator*() const noexcept { return this->mask; }
+        constexpr Iterator& operator++() noexcept {
+            if (this->mask == 0)
+                return this->next = false, *this;
+            auto low = this->mask & -this->mask, high = this->mask + low;
+            this->mask = (((high ^ this->mask) >> 2) / low) | high;
+            this->next =
+                high != 0 && (this->n == 64 || this->mask >> this->n == 0);
+            return *this;
+        }
+        constexpr bool operator!=(Sentinel) const noexcept {
+            return this->next;
+        }
+    };
+
+    constexpr Iterator begin() const noexcept {
+        return Iterator(this->n, this->k);
+    }
+    constexpr Sentinel end() const noexcept { return Sentinel(); }
+
+    /// @brief Range over the subsets as sorted index arrays, in lexicographic
+    /// order. Obtained from `Comb::indices()`.
+    class Indices final {
+        uintptr_t n, k;
+
+      public:
+        constexpr Indices(uintptr_t n, uintptr_t k) noexcept : n(n), k(k) {}
+        class Iterator final {
+            std::vector<uintptr_t> buf;
+            uintptr_t n;
+            bool next;
+
+          public:
+            inline Iterator(uintptr_t n, uintptr_t k)
+                : buf(std::vector<uintptr_t>(k)), n(n), next(k <= n) {
+                for (auto i : rng(k))
+                    this->buf[i] = i;
+            }
+            inline std::vector<uintptr_t> const& operator*() const noexcept {
+                return this->buf;
+            }
+            inline Iterator& operator++() noexcept {
+                auto k = this->buf.size(), i = k;
+                while (i > 0 && this->buf[i - 1] == this->n - k + i - 1)
+                    i--;
+                if (i == 0)
+                    return this->next = false, *this;
+                this->buf[i - 1]++;
+                for (; i < k; i++)
+                    this->buf[i] = this->buf[i - 1] + 1;
+                return *this;
+            }
+            constexpr bool operator!=(Sentinel) const noexcept {
+                return this->next;
+            }
+        };
+        inline Iterator begin() const { return Iterator(this->n, this->k); }
+        constexpr Sentinel end() const noexcept { return Sentinel(); }
+    };
+
+    /// @brief Subsets as sorted index arrays, in lexicographic order.
+    constexpr Indices indices() const noexcept {
+        return Indices(this->n, this->k);
+    }
+
+    /// @brief Single-pass range over the subsets as sorted index arrays, in
+    /// revolving-door order (Knuth's Algorithm 7.2.1.3R), where each step
+    /// removes one element and adds another. Obtained from
+    /// `Comb::revolving()`.
+    ///
+    /// # Example
+    ///
+    /// ```cpp
+    ///
+    /// auto r = ll::Comb(n, k).revolving();
+    ///
+    /// for (auto& c : r) {
+    ///
+    ///     auto [out, in] = r.changed(); // update the cost in O(1)
+    ///
+    /// }
+    ///
+    /// ```
+    class Revolving final {
+        /// @brief The subset, sorted.
+        std::vector<uintptr_t> c;
+        uintptr_t n;
+        uint64_t bits;
+        std::pair<uintptr_t, uintptr_t> last = {0, 0};
+        bool more;
+
+        /// @brief Record that `out` left the subset and `in` joined.
+        inline bool swapped(uintptr_t out, uintptr_t in) noexcept {
+            this->last = {out, in};
+            if (this->n <= 64)
+                this->bits ^= uint64_t(1) << out ^ uint64_t(1) << in;
+            return true;
+        }
+
+      public:
+        inline Revolving(uintptr_t n, uintptr_t k)
+            : c(std::vector<uintptr_t>(k)), n(n),
+              bits(k == 0 || k > n || n > 64 ? 0 : ~uint64_t(0) >> (64 - k)),
+              more(k <= n) {
+            for (auto i : rng(k))
+                this->c[i] = i;
+        }
+
+        /// @brief The current subset, sorted.
+        inline std::vector<uintptr_t> const& get() const noexcept {
+            return this->c;
+        }
+
+        /// @brief The current subset as a mask if `n <= 64`, otherwise 0.
+        inline uint64_t mask() const noexcept { return this->bits; }
+
+        /// @brief The element removed and the element added by the last
+        /// step, or (0, 0) before the first step.
+        inline std::pair<uintptr_t, uintptr_t> changed() const noexcept {
+            return this->last;
+        }
+
+        /// @brief Step to the next subset.
+        /// @return whether there was a next subset
+        inline bool next() noexcept {
+            // j is one-based as in Knuth's text, so c_j is c[j - 1]
+            auto& c = this->c;
+            uintptr_t t = c.size();
+            auto upper = [&](uintptr_t j) { return j < t ? c[j] : this->n; };
+            if (t == 0)
+                return this->more = false;
+            if (t % 2 == 1 && c[0] + 1 < upper(1))
+                return this->swapped(c[0], c[0] + 1), c[0]++, true;
+            if (t % 2 == 0 && c[0] > 0)
+                return this->swapped(c[0], c[0] - 1), c[0]--, true;
+            auto up = t % 2 == 0;
+            for (uintptr_t j = 2; j <= t; j++, up = !up)
+                if (!up && c[j - 1] >= j) {
+                    // c_j = c_{j-1} + 1 leaves, j - 2 joins
+                    this->swapped(c[j - 1], j - 2);
+                    c[j - 1] = c[j - 2];
+                    c[j - 2] = j - 2;
+                    return true;
+                } else if (up && c[j - 1] + 1 < upper(j)) {
+                    // c_{j-1} = j - 2 leaves, c_j + 1 joins
+                    this->swapped(j - 2, c[j - 1] + 1);
+                    c[j - 2] = c[j - 1];
+                    c[j - 1]++;
+                    return true;
+                }
+            return this->more = false;
+        }
+
+        class Iterator final {
+            Revolving* rev;
+
+          public:
+            constexpr Iterator(Revolving* rev) noexcept : rev(rev) {}
+            inline std::vector<uintptr_t> const& operator*() const noexcept {
+                return this->rev->c;
+            }
+            inline Iterator& operator++() noexcept {
+                this->rev->next();
+                return *this;
+            }
+            constexpr bool operator!=(Sentinel) const noexcept {
+                return this->rev->more;
+            }
+        };
+        inline Iterator begin() noexcept { return Iterator(this); }
+        constexpr Sentinel end() noexcept { return Sentinel(); }
+    };
+
+    /// @brief Subsets in revolving-door order.
+    /// @return a single-pass range, see `Revolving`
+    inline Revolving revolving() const {
+        return Revolving(this->n, this->k);
+    }
+};
+
+/// @brief Range over all masks of `n` bits in Gray-code order, where
+/// consecutive masks differ in exactly one bit. Obtained from `subsets`.
+class Gray final {
+    uint64_t const len;
+
+  public:
+    constexpr Gray(uintptr_t n) noexcept : len(uint64_t(1) << n) {}
+    class Iterator final {
+        uint64_t i;
+
+      public:
+        constexpr Iterator(uint64_t i) noexcept : i(i) {}
+        constexpr uint64_t operator*() const noexcept {
+            return this->i ^ this->i >> 1;
+        }
+        constexpr Iterator& operator++() noexcept {
+            ++this->i;
+            return *this;
+        }
+        constexpr bool operator!=(Iterator const& rhs) const noexcept {
+            return this->i != rhs.i;
+        }
+    };
+    constexpr Iterator begin() const noexcept { return Iterator(0); }
+    constexpr Iterator end() const noexcept { return Iterator(this->len); }
+};
+
+/// @brief All masks of `n` bits, in Gray-code order.
+/// @param n number of bits, less than 64
+/// @return new `Gray`
+constexpr Gray subsets(uintptr_t n) noexcept { return Gray(n); }
+
+/// @brief Range over the submasks of a mask in descending order, from the
+/// mask itself down to 0. Obtained from `submasks`.
+class Submasks final {
+    uint64_t const mask;
+
+  public:
+    constexpr Submasks(uint64_t mask) noexcept : mask(mask) {}
+    class Iterator final {
+        uint64_t curr, mask;
+        bool next = true;
+
+      public:
+        constexpr Iterator(uint64_t mask) noexcept : curr(mask), mask(mask) {}
+        constexpr uint64_t operator*() const noexcept { return this->curr; }
+        constexpr Iterator& operator++() noexcept {
+            this->next = this->curr != 0;
+            this->curr = (this->curr - 1) & this->mask;
+            return *this;
+        }
+        constexpr bool operator!=(Sentinel) const noexcept {
+            return this->next;
+        }
+    };
+    constexpr Iterator begin() const noexcept { return Iterator(this->mask); }
+    constexpr Sentinel end() const noexcept { return Sentinel(); }
+};
+
+/// @brief The submasks of `mask`, in descending order.
+/// @param mask the mask
+/// @return new `Submasks`
+constexpr Submasks submasks(uint64_t mask) noexcept { return Submasks(mask); }
+
+/// @brief Range over the supermasks of a mask within `n` bits in ascending
+/// order, from the mask itself up to all ones. Obtained from `supermasks`.
+class Supermasks final {
+    uint64_t const mask, full;
+
+  public:
+    constexpr Supermasks(uint64_t mask, uintptr_t n) noexcept
+        : mask(mask), full(n == 64 ? ~uint64_t(0) : (uint64_t(1) << n) - 1) {}
+    class Iterator final {
+        uint64_t curr, mask, full;
+        bool next = true;
+
+      public:
+        constexpr Iterator(uint64_t mask, uint64_t full) noexcept
+            : curr(mask), mask(mask), full(full) {}
+        constexpr uint64_t operator*() const noexcept { return this->curr; }
+        constexpr Iterator& operator++() noexcept {
+            this->next = this->curr != this->full;
+            this->curr = (this->curr + 1) | this->mask;
+            return *this;
+        }
+        constexpr bool operator!=(Sentinel) const noexcept {
+            return this->next;
+        }
+    };
+    constexpr Iterator begin() const noexcept {
+        return Iterator(this->mask, this->full);
+    }
+    constexpr Sentinel end() const noexcept { return Sentinel(); }
+};
+
+/// @brief The supermasks of `mask` within `n` bits, in ascending order.
+/// @param mask the mask
+/// @param n number of bits
+/// @return new `Supermasks`
+constexpr Supermasks supermasks(uint64_t mask, uintptr_t n) noexcept {
+    return Supermasks(mask, n);
+}
+
+/// @brief In-place sum-over-subsets transform or its inverse, on a table
+/// indexed by masks.
+/// @tparam Super whether to sum over supermasks instead of submasks
+/// @tparam Inverse whether to apply the inverse (Möbius) transform
+/// @param f the table, whose size must be a power of two
+///
+/// Bits are processed in two phases to stay cache-friendly. The low bits are
+/// done one cache-sized block at a time. The remaining high bits are done two
+/// per pass over the table, each pass streaming four contiguous quarters
+/// whose inner loop vectorizes.
+template <bool Super, bool Inverse, typename T>
+inline void subset_transform(std::vector<T>& f) {
+    auto step = [](T& lo, T& hi) {
+        if constexpr (Super && Inverse)
+            lo -= hi;
+        else if constexpr (Super)
+            lo += hi;
+        else if constexpr (Inverse)
+            hi -= lo;
+        else
+            hi += lo;
+    };
+    uintptr_t len = f.size(), block = std::min<uintptr_t>(len, 1 << 11);
+    auto data = f.data();
+    for (uintptr_t base = 0; base < len; base += block)
+        for (uintptr_t half = 1; half < block; half *= 2)
+            for (auto i = base; i < base + block; i += 2 * half)
+                for (auto j = i; j < i + half; j++)
+                    step(data[j], data[j + half]);
+    auto half = block;
+    for (; half * 2 < len; half *= 4)
+        for (uintptr_t i = 0; i < len; i += 4 * half) {
+            auto a = data + i, b = a + half, c = b + half, d = c + half;
+            for (uintptr_t j = 0; j < half; j++) {
+                step(a[j], b[j]);
+                step(c[j], d[j]);
+                step(a[j], c[j]);
+                step(b[j], d[j]);
+            }
+        }
+    if (half < len)
+        for (uintptr_t j = 0; j < half; j++)
+            step(data[j], data[j + half]);
+}
+
+/// @brief In-place zeta transform, turning `f[S]` into the sum of `f[T]`
+/// over all submasks `T` of `S` (or supermasks, if `Super`).
+/// @param f the table, whose size must be a power of two
+template <bool Super = false, typename T> inline void zeta(std::vector<T>& f) {
+    subset_transform<Super, false>(f);
+}
+
+/// @brief In-place Möbius transform, the inverse of `zeta`.
+/// @param f the table, whose size must be a power of two
+template <bool Super = false, typename T>
+inline void mobius(std::vector<T>& f) {
+    subset_transform<Super, true>(f);
+}
+
+/// @brief A partial arrangement built by `backtrack`, valid only during the
+/// callback it is passed to.
+class Prefix final {
+    uintptr_t const* items;
+    uintptr_t len;
+
+  public:
+    /// @brief Mask of the items in the prefix.
+    uint64_t const used;
+
+    constexpr Prefix(uintptr_t const* items, uintptr_t len,
+                     uint64_t used) noexcept
+        : items(items), len(len), used(used) {}
+    constexpr uintptr_t size() const noexcept { return this->len; }
+    constexpr uintptr_t operator[](uintptr_t i) const noexcept {
+        return this->items[i];
+    }
+    constexpr uintptr_t const* begin() const noexcept { return this->items; }
+    constexpr uintptr_t const* end() const noexcept {
+        return this->items + this->len;
+    }
+};
+
+/// @brief Depth-first branch-and-bound search over the arrangements of `k`
+/// out of `n` items, built position by position. With `k == n` these are
+/// the permutations of [0, n).
+/// @param n number of items, at most 64
+/// @param k length of each arrangement
+/// @param init the cost of the empty prefix
+/// @param extend the function taking a copy of the prefix cost by reference
+/// to update, the `Prefix`, and the item to append, returning a `Flow`:
+/// `Skip` prunes every arrangement starting with the extended prefix
+/// @param visit the function taking the cost and the `Prefix` of each
+/// complete arrangement, returning a `Flow` or nothing
+/// @return whether the search was stopped by `Flow::Stop`
+///
+/// The search is iterative. The used set is a bitmask and the costs live in
+/// one stack allocated up front, so no level allocates. Items are tried in
+/// increasing order.
+///
+/// # Example
+///
+/// ```cpp
+///
+/// int64_t best = INT64_MAX;
+///
+/// ll::backtrack(n, n, int64_t(0), [&](int64_t& c, auto& p, uintptr_t i) {
+///
+///     c += p.size() ? w[p[p.size() - 1]][i] : 0;
+///
+///     return c >= best ? ll::Flow::Skip : ll::Flow::Continue;
+///
+/// }, [&](int64_t c, auto&) { best = c; }); // shortest Hamiltonian path
+///
+/// ```
+template <typename C, typename E, typename V>
+inline bool backtrack(uintptr_t n, uintptr_t k, C init, E extend, V visit) {
+    auto report = [&](C const& cost, Prefix const& prefix) {
+        if constexpr (std::is_void_v<decltype(visit(cost, prefix))>)
+            return visit(cost, prefix), false;
+        else
+            return visit(cost, prefix) == Flow::Stop;
+    };
+    if (k > n)
+        return false;
+    if (k == 0)
+        return report(init, Prefix(nullptr, 0, 0));
+    auto full = n == 64 ? ~uint64_t(0) : (uint64_t(1) << n) - 1;
+    auto items = std::vector<uintptr_t>(k);
+    auto cost = std::vector<C>(k + 1, init);
+    // candidates not yet tried at each depth
+    auto left = std::vector<uint64_t>(k);
+    uint64_t used = 0;
+    uintptr_t depth = 0;
+    left[0] = full;
+    while (true) {
+        if (left[depth] == 0) {
+            if (depth == 0)
+                return false;
+            depth--;
+            used ^= uint64_t(1) << items[depth];
+            continue;
+        }
+        auto item = uintptr_t(__builtin_ctzll(left[depth]));
+        left[depth] &= left[depth] - 1;
+        cost[depth + 1] = cost[depth];
+        auto const prefix = Prefix(items.data(), depth, used);
+        auto flow = extend(cost[depth + 1], prefix, item);
+        if (flow == Flow::Stop)
+            return true;
+        if (flow == Flow::Skip)
+            continue;
+        items[depth] = item;
+        if (depth + 1 == k) {
+            auto bit = uint64_t(1) << item;
+            if (report(cost[k], Prefix(items.data(), k, used | bit)))
+                return true;
+            continue;
+        }
+        used |= uint64_t(1) << item;
+        depth++;
+        left[depth] = full & ~used;
+    }
+}
+
+/// @brief A fixed-size, zero-initialized array aligned to cache lines.
+/// @tparam T a trivial element type
+///
+/// Buffers of at least `HUGE` bytes are instead aligned to 2 MB and, when
+/// `LL_HUGE_PAGE` is on (the default on Linux), advised into transparent huge
+/// pages, which cuts TLB misses of random access over large arrays.
+template <typename T> class Buffer final {
+    T* ptr = nullptr;
+    uintptr_t len = 0;
+
+    /// @brief Alignment used for an allocation of `bytes` bytes.
+    static constexpr uintptr_t align(uintptr_t bytes) noexcept {
+        return bytes >= HUGE ? HUGE : 64;
+    }
+
+    /// @brief Allocated size in bytes, rounded up to whole alignment units.
+    constexpr uintptr_t bytes() const noexcept {
+        auto a = align(this->len * sizeof(T));
+        return (this->len * sizeof(T) + a - 1) / a * a;
+    }
+
+  public:
+    /// @brief Threshold in bytes above which huge pages are used.
+    static constexpr uintptr_t HUGE = 1 << 21;
+
+    /// @brief Create an empty buffer.
+    constexpr Buffer() noexcept = default;
+
+    /// @brief Allocate a buffer of `len` zeroed elements.
+    /// @param len number of elements
+    explicit Buffer(uintptr_t len) : len(len) {
+        if (len == 0)
+            return;
+        auto a = align(len * sizeof(T));
+        this->ptr = static_cast<T*>(
+            ::operator new(this->bytes(), std::align_val_t(a)));
+        if (a == HUGE)
+            (void)LL_MADVISE_HUGE(this->ptr, this->bytes());
+        std::memset(this->ptr, 0, this->bytes());
+    }
+
+    Buffer(Buffer const&) = delete;
+    Buffer& operator=(Buffer const&) = delete;
+    Buffer(Buffer&& rhs) noexcept { *this = std::move(rhs); }
+    Buffer& operator=(Buffer&& rhs) noexcept {
+        std::swap(this->ptr, rhs.ptr);
+        std::swap(this->len, rhs.len);
+        return *this;
+    }
+
+    ~Buffer() {
+        if (this->ptr)
+            ::operator delete(this->ptr,
+                              std::align_val_t(align(len * sizeof(T))));
+    }
+
+    /// @brief Number of elements.
+    constexpr uintptr_t size() const noexcept { return this->len; }
+
+    /// @brief Pointer to the first element.
+    constexpr T* data() const noexcept { return this->ptr; }
+
+    /// @brief Access an element without boundary check.
+    constexpr T& operator[](uintptr_t i) const noexcept { return this->ptr[i]; }
+
+    /// @brief Set every element to `value`.
+    inline void fill(T const& value) noexcept {
+        std::fill(this->ptr, this->ptr + this->len, value);
+    }
+};
+
+/// @brief Reference to an element that bumps a revision counter when written
+/// through, and reads like a plain `T`.
+template <typename T> class Tracked final {
+    T& ref;
+    uint64_t& revision;
+
+  public:
+    constexpr Tracked(T& ref, uint64_t& revision) noexcept
+        : ref(ref), revision(revision) {}
+    constexpr operator T const&() const noexcept { return this->ref; }
+    constexpr Tracked const& operator=(T const& value) const noexcept {
+        this->ref = value;
+        this->revision++;
+        return *this;
+    }
+    constexpr Tracked const& operator=(Tracked const& rhs) const noexcept {
+        return *this = T(rhs);
+    }
+    friend inline std::istream& operator>>(std::istream& input,
+                                           Tracked const& tile) {
+        input >> tile.ref;
+        tile.revision++;
+        return input;
+    }
+    friend inline std::ostream& operator<<(std::ostream& output,
+                                           Tracked const& tile) {
+        return output << tile.ref;
+    }
+};
+
+/// @brief A cell of the global 2D grid map.
+/// @tparam Check whether to assert bounds and visited-state invariants
+/// @tparam Wrap whether the grid is a torus, where `dx`, `dy` and neighbors
+/// wrap around the edges
+///
+/// With `Check` enabled, every unchecked access (`tile()`, `done()`) and every
+/// traversal aborts through `panic` on an out-of-range cell or a corrupted
+/// visited flag. With `Check` disabled none of these checks is generated. The
+/// default follows the `LL_CHECK` macro, which is on iff `LL_DEBUG` is defined.
+template <bool Check = LL_CHECK, bool Wrap = false> class BasicGrid final {
+  private:
+    static constexpr uintptr_t W = 1024, H = 1024;
+    using T = char;
+    /// @brief Tiles, row-major.
+    static inline Buffer<T> MAP = Buffer<T>(W * H);
+    /// @brief Visited stamps, row-major. A cell is done iff its stamp equals
+    /// `EPOCH`, so that `refresh()` only needs to advance the epoch.
+    static inline Buffer<uint8_t> DONE = Buffer<uint8_t>(W * H);
+    static inline uint8_t EPOCH = 1;
+    /// @brief Bumped whenever the tiles may have changed.
+    static inline uint64_t REVISION = 1;
+
+  public:
+    static inline uintptr_t WIDTH = W, HEIGHT = H;
+
+    /// @brief Set the width and height of the grid, reallocating storage if
+    /// it is not large enough. The tiles are unspecified afterwards and all
+    /// `.done()` flags are reset.
+    /// @param width width, or the first index of array
+    /// @param height height, or the second index of array
+    static inline void set(uintptr_t width, uintptr_t height) {
+        if (width * height > MAP.size()) {
+            MAP = Buffer<T>(width * height);
+            DONE = Buffer<uint8_t>(width * height);
+        } else
+            DONE.fill(0);
+        EPOCH = 1;
+        REVISION++;
+        WIDTH = width;
+        HEIGHT = height;
+    }
+
+    /// @brief Initialize the grid reading input from `input`
+    /// @param input the stream to read
+    static inline void init(std::istream& input) noexcept {
+        for (auto y : rng(HEIGHT))
+            for (auto x : rng(WIDTH))
+                input >> MAP[y * WIDTH + x];
+        REVISION++;
+    }
+
+    /// @brief Output the grid to `output`
+    /// @param output the stream to write to
+    static inline void output(std::ostream& output) noexcept {
+        for (auto y : rng(HEIGHT)) {
+            for (auto x : rng(WIDTH))
+                output << MAP[y * WIDTH + x];
+            output << std::endl;
+        }
+    }
+
+    /// @brief Pretty print the grid to `stderr`.
+    static inline void debug() noexcept {
+        std::cerr << std::endl << "┌";
+        for (auto _ : rng(WIDTH))
+            std::cerr << "─";
+        std::cerr << WIDTH << std::endl;
+        for (auto y : rng(HEIGHT)) {
+            std::cerr << "│";
+            for (auto x : rng(WIDTH))
+                std::cerr << MAP[y * WIDTH + x];
+            std::cerr << std::endl;
+        }
+        std::cerr << HEIGHT << std::endl << std::endl;
+    }
+
+    /// @brief Reset all `.done()` flags. This is O(1) except once every 255
+    /// calls.
+    static inline void refresh() noexcept {
+        if (++EPOCH == 0) {
+            DONE.fill(0);
+            EPOCH = 1;
+        }
+    }
+
+    /// @brief Reference to the `.done()` flag of a cell.
+    class Flag final {
+        uint8_t& stamp;
+
+      public:
+        constexpr Flag(uint8_t& stamp) noexcept : stamp(stamp) {}
+        constexpr operator bool() const noexcept { return stamp == EPOCH; }
+        constexpr Flag& operator=(bool value) noexcept {
+            stamp = value ? EPOCH : 0;
+            return *this;
+        }
+    };
+
+    /// @brief x-coordinate of the cell.
+    uintptr_t const x;
+
+    /// @brief y-coordinate of the cell.
+    uintptr_t const y;
+
+    /// @brief Create an always-invalid cell.
+    constexpr BasicGrid() noexcept : x(-1), y(-1) {}
+
+    /// @brief Create a cell with specified coordinates.
+    /// @param x x-coordinate of the cell
+    /// @param y y-coordinate of the cell
+    constexpr BasicGrid(uintptr_t x, uintptr_t y) noexcept : x(x), y(y) {}
+
+    /// @brief Calculate new `Grid` with difference `dx` in x coordinate.
+    /// @param dx difference in x
+    /// @return the translated cell
+    constexpr BasicGrid dx(intptr_t dx) const noexcept {
+        if constexpr (Wrap)
+            return BasicGrid(wrap(this->x, dx, WIDTH), this->y);
+        else
+            return BasicGrid(this->x + dx, this->y);
+    }
+
+    /// @brief Calculate new `Grid` with difference `dy` in y coordinate.
+    /// @param dy difference in y
+    /// @return the translated cell
+    constexpr BasicGrid dy(intptr_t dy) const noexcept {
+        if constexpr (Wrap)
+            return BasicGrid(this->x, wrap(this->y, dy, HEIGHT));
+        else
+            return BasicGrid(this->x, this->y + dy);
+    }
+
+    /// @brief Check whether two `Grid`s indicates the same position.
+    /// @param rhs right-hand side of operator
+    /// @return result of equivalance operator
+    constexpr bool operator==(BasicGrid rhs) const noexcept {
+        return this->x == rhs.x && this->y == rhs.y;
+    };
+
+    /// @brief Whether this `Grid` cell indicates a valid position in the grid.
+    /// @return result of check
+    constexpr bool valid() const noexcept {
+        return x >= 0 && x < WIDTH && y >= 0 && y < HEIGHT;
+    }
+
+    /// @brief Visit the content in specified position.
+    /// @return reference to content, which invalidates `components()` when
+    /// assigned to but not when read
+    /// @warning This does not perform any boundary check.
+    inline Tracked<T> tile() const noexcept {
+        this->check("Grid::tile: out of bounds");
+        return Tracked<T>(MAP[this->index()], REVISION);
+    }
+
+    /// @brief Read the content in specified position.
+    /// @return reference to content
+    /// @warning This does not perform any boundary check.
+    constexpr T const& get() const noexcept {
+        this->check("Grid::get: out of bounds");
+        return MAP[this->index()];
+    }
+
+    /// @brief Output the `Grid` cell in the format "(x, y)".
+    /// @param output the stream to output to
+    /// @param cell the instatnce to output
+    /// @return `output` for chaining
+    friend constexpr std::ostream& operator<<(std::ostream& output,
+                                              BasicGrid cell) noexcept {
+        return output << "(" << cell.x << "," << cell.y << ")";
+    }
+
+    /// @brief Flag that indicates whether a cell has been processed.
+    /// @return reference to flag
+    inline Flag done() const noexcept {
+        this->check("Grid::done: out of bounds");
+        return DONE[this->index()];
+    }
+
+    /// @brief Gets the neighboring cells (if valid) of the given cell.
+    /// @return list of cells
+    /// @todo constexpr when c++23
+    inline std::vector<BasicGrid> neighbor() const noexcept {
+        auto res = std::vector<BasicGrid>();
+        for (auto cell : {this->dy(1), this->dx(1), this->dx(-1), this->dy(-1)})
             if (cell.valid())
                 res.push_back(cell);
         return res;
@@ -321,39 +2352,529 @@ class Grid final {
     /// @param cond the condition function that judges whether to walk into a
     /// cell
     /// @param then the function to execute on the cell
-    inline void walk(std::function<bool(Grid)> cond,
-                     std::function<void(Grid)> then) const noexcept {
-        if (!this->valid())
+    inline void walk(std::function<bool(BasicGrid)> cond,
+                     std::function<void(BasicGrid)> then) const noexcept {
+        if (this->valid())
+            this->walk_valid(cond, then);
+    }
+
+    /// @brief Traverse the grid cells that match `cond` starting from `this`
+    /// depth-first, in the same order as `walk`, under control of the
+    /// visitors. Cells already `.done()` are not entered.
+    /// @param cond the condition function that judges whether to walk into a
+    /// cell
+    /// @param pre the function executed when entering a cell, before its
+    /// neighbors, returning a `Flow`
+    /// @param post the function executed when leaving a cell, after its
+    /// neighbors, returning a `Flow`
+    /// @return whether the traversal was stopped by `Flow::Stop`
+    ///
+    /// # Example
+    ///
+    /// ```cpp
+    ///
+    /// auto open = [](Grid g) { return g.get() != '#'; };
+    ///
+    /// auto reach = src.search(open, [&](Grid g) {
+    ///
+    ///     return g == dst ? Flow::Stop : Flow::Continue;
+    ///
+    /// }); // explores only until `dst` is found
+    ///
+    /// ```
+    template <typename C, typename Pre, typename Post>
+    inline bool search(C cond, Pre pre, Post post) const {
+        if (!this->valid() || this->done() || !cond(*this))
+            return false;
+        auto& stack = SEARCH_STACK;
+        stack.clear();
+        auto enter = [&](BasicGrid g) {
+            g.done() = true;
+            auto flow = pre(g);
+            stack.push_back(
+                SearchFrame{uint32_t(g.x), uint32_t(g.y),
+                            uint8_t(flow == Flow::Skip ? 4 : 0)});
+            return flow == Flow::Stop;
+        };
+        if (enter(*this))
+            return true;
+        while (!stack.empty()) {
+            auto& f = stack.back();
+            auto cell = BasicGrid(f.x, f.y);
+            if (f.dir < 4) {
+                auto d = f.dir++;
+                auto g = d == 0   ? cell.dy(1)
+                         : d == 1 ? cell.dx(1)
+                         : d == 2 ? cell.dx(-1)
+                                  : cell.dy(-1);
+                if (!Wrap && !g.valid())
+                    continue;
+                if (!g.done() && cond(g) && enter(g))
+                    return true;
+                continue;
+            }
+            stack.pop_back();
+            if (post(cell) == Flow::Stop)
+                return true;
+        }
+        return false;
+    }
+
+    /// @brief Traverse depth-first with only a pre-order visitor. See
+    /// `search(cond, pre, post)`.
+    template <typename C, typename Pre>
+    inline bool search(C cond, Pre pre) const {
+        auto post = [](BasicGrid) { return Flow::Continue; };
+        return this->search(cond, pre, post);
+    }
+
+    /// @brief Traverse the grid cells that match `cond` starting from `this`
+    /// in breadth-first order, executing `then` on each. Cells already
+    /// `.done()` are not entered.
+    /// @param cond the condition function that judges whether to walk into a
+    /// cell
+    /// @param then the function to execute on the cell and its distance from
+    /// `this`
+    template <typename C, typename F>
+    inline void bfs(C cond, F then) const {
+        if (!this->valid() || this->done() || !cond(*this))
             return;
+        if (QUEUE.size() < WIDTH * HEIGHT)
+            QUEUE = Buffer<uint32_t>(WIDTH * HEIGHT);
+        uintptr_t head = 0, tail = 0, level = 1;
+        uint64_t dist = 0;
+        this->done() = true;
+        QUEUE[tail++] = this->index();
+        while (head < tail) {
+            if (head == level) {
+                dist++;
+                level = tail;
+            }
+            auto i = QUEUE[head++];
+            auto cell = BasicGrid(i % WIDTH, i / WIDTH);
+            then(cell, dist);
+            cell.each_neighbor([&](BasicGrid g) {
+                if (g.done() || !cond(g))
+                    return;
+                g.done() = true;
+                QUEUE[tail++] = g.index();
+            });
+        }
+    }
+
+  private:
+    /// @brief Queue of storage indices for `bfs`.
+    static inline Buffer<uint32_t> QUEUE;
+
+    /// @brief A frame of the explicit DFS stack of `search`.
+    struct SearchFrame final {
+        uint32_t x, y;
+        /// @brief Next direction to try, 4 when exhausted or skipped.
+        uint8_t dir;
+    };
+    static inline std::vector<SearchFrame> SEARCH_STACK;
+
+    /// @brief Execute `f` on each valid neighboring cell, in the order of
+    /// `neighbor()`, without allocating.
+    template <typename F> constexpr void each_neighbor(F f) const {
+        if (Wrap || this->y + 1 < HEIGHT)
+            f(this->dy(1));
+        if (Wrap || this->x + 1 < WIDTH)
+            f(this->dx(1));
+        if (Wrap || this->x > 0)
+            f(this->dx(-1));
+        if (Wrap || this->y > 0)
+            f(this->dy(-1));
+    }
+
+    /// @brief Coordinate `v + d` wrapped into [0, n). Power-of-two `n` is
+    /// wrapped by masking instead of modulo.
+    static constexpr uintptr_t wrap(uintptr_t v, intptr_t d,
+                                    uintptr_t n) noexcept {
+        if ((n & (n - 1)) == 0)
+            return (v + d) & (n - 1);
+        auto r = (intptr_t(v) + d) % intptr_t(n);
+        return r < 0 ? r + n : r;
+    }
+
+    /// @brief Offset of this cell in the row-major storage.
+    constexpr uintptr_t index() const noexcept {
+        return this->y * WIDTH + this->x;
+    }
+
+    /// @brief Abort with `what` if this cell is out of the grid. Generates no
+    /// code unless `Check` is enabled.
+    /// @param what the message to print
+    constexpr void check(char const* what) const noexcept {
+        if constexpr (Check)
+            if (!this->valid()) {
+                std::cerr << *this << " ";
+                panic(what);
+            }
+    }
+
+    /// @brief Recursive part of `walk`, where `this` is known to be valid.
+    inline void walk_valid(std::function<bool(BasicGrid)> const& cond,
+                           std::function<void(BasicGrid)> const& then) const {
         if (this->done())
             return;
         if (!cond(*this))
             return;
         this->done() = true;
-        for (auto g : this->neighbor())
-            g.walk(cond, then);
+        this->each_neighbor([&](BasicGrid g) { g.walk_valid(cond, then); });
+        if constexpr (Check)
+            if (!this->done()) {
+                std::cerr << *this << " ";
+                panic("Grid::walk: visited flag cleared during traversal");
+            }
         then(*this);
     }
 
+  public:
     /// @brief Connected area from this cell.
     /// @return size of area
     constexpr uint64_t conn_area() const noexcept {
         uint64_t ans = 0;
-        auto cond = [&](Grid map) { return map.tile() == this->tile(); };
+        auto cond = [&](BasicGrid map) { return map.get() == this->get(); };
         auto then = [&](auto) { ans++; };
         this->walk(cond, then);
         return ans;
     }
 
+    /// @brief Fold `op` over the cells matching `cond` connected to `seed`,
+    /// in one breadth-first traversal. Cells already `.done()` are skipped.
+    /// @param seed the cell to start from
+    /// @param cond the condition function that judges whether to walk into a
+    /// cell
+    /// @param init the initial accumulator
+    /// @param op the function taking the accumulator and a cell, returning
+    /// the new accumulator
+    /// @return the final accumulator
+    ///
+    /// # Example
+    ///
+    /// ```cpp
+    ///
+    /// auto same = [&](Grid g) { return g.get() == seed.get(); };
+    ///
+    /// auto box = std::array{seed.x, seed.y, seed.x, seed.y};
+    ///
+    /// box = Grid::reduce_component(seed, same, box, [](auto b, Grid g) {
+    ///
+    ///     return std::array{std::min(b[0], g.x), std::min(b[1], g.y),
+    ///
+    ///                       std::max(b[2], g.x), std::max(b[3], g.y)};
+    ///
+    /// }); // bounding box of the component
+    ///
+    /// ```
+    template <typename C, typename A, typename F>
+    static inline A reduce_component(BasicGrid seed, C cond, A init, F op) {
+        seed.bfs(cond, [&](BasicGrid g, uint64_t) {
+            init = op(std::move(init), g);
+        });
+        return init;
+    }
+
+    /// @brief Connected components of the grid, where adjacent cells with
+    /// equal tiles are connected. Obtained from `components()`.
+    class Components final {
+        friend class BasicGrid;
+
+        /// @brief `REVISION` this index was built at.
+        uint64_t revision = 0;
+        /// @brief Component id of each cell, row-major.
+        Buffer<uint32_t> label;
+        /// @brief Number of cells in each component.
+        std::vector<uint64_t> sizes;
+        /// @brief Storage index of the first cell of each component.
+        std::vector<uint32_t> repr;
+
+        /// @brief Label the grid by two raster scans with union-find.
+        ///
+        /// The first scan unions every cell with its left and upper
+        /// neighbors, always linking the larger root under the smaller, so
+        /// that a parent never follows its child in storage order. The second
+        /// scan can then turn parents into ids in place.
+        inline void build() {
+            auto n = WIDTH * HEIGHT;
+            if (this->label.size() < n)
+                this->label = Buffer<uint32_t>(n);
+            auto& par = this->label;
+            auto find = [&](uint32_t i) {
+                while (par[i] != i)
+                    i = par[i] = par[par[i]];
+                return i;
+            };
+            auto unite = [&](uint32_t a, uint32_t b) {
+                a = find(a), b = find(b);
+                if (a < b)
+                    par[b] = a;
+                else
+                    par[a] = b;
+            };
+            for (uint32_t i = 0; i < n; i++) {
+                par[i] = i;
+                if (i % WIDTH != 0 && MAP[i - 1] == MAP[i])
+                    unite(i - 1, i);
+                if (i >= WIDTH && MAP[i - WIDTH] == MAP[i])
+                    unite(i - WIDTH, i);
+            }
+            if constexpr (Wrap) {
+                for (uint32_t i = 0; i < n; i += WIDTH)
+                    if (MAP[i] == MAP[i + WIDTH - 1])
+                        unite(i, i + WIDTH - 1);
+                for (uint32_t i = 0; i < WIDTH; i++)
+                    if (MAP[i] == MAP[n - WIDTH + i])
+                        unite(i, n - WIDTH + i);
+            }
+            this->sizes.clear();
+            this->repr.clear();
+            for (uint32_t i = 0; i < n; i++) {
+                if (par[i] == i) {
+                    par[i] = this->repr.size();
+                    this->repr.push_back(i);
+                    this->sizes.push_back(0);
+                } else
+                    par[i] = par[par[i]];
+                this->sizes[par[i]]++;
+            }
+            this->revision = REVISION;
+        }
+
+      public:
+        /// @brief Rebuild the index if tiles have changed since last built.
+        inline void sync() {
+            if (this->revision != REVISION)
+                this->build();
+        }
+
+        /// @brief Number of components.
+        inline uintptr_t count() {
+            this->sync();
+            return this->repr.size();
+        }
+
+        /// @brief Component id of `cell`, in [0, count()).
+        inline uint32_t id(BasicGrid cell) {
+            cell.check("Grid::Components: out of bounds");
+            this->sync();
+            return this->label[cell.index()];
+        }
+
+        /// @brief Size of the component containing `cell`.
+        inline uint64_t size(BasicGrid cell) {
+            return this->sizes[this->id(cell)];
+        }
+
+        /// @brief Whether `a` and `b` are in the same component.
+        inline bool same(BasicGrid a, BasicGrid b) {
+            return this->id(a) == this->id(b);
+        }
+
+        /// @brief The first cell in row-major order of the component
+        /// containing `cell`.
+        inline BasicGrid representative(BasicGrid cell) {
+            auto i = this->repr[this->id(cell)];
+            return BasicGrid(i % WIDTH, i / WIDTH);
+        }
+    };
+
+  private:
+    static inline Components COMPONENTS;
+
+  public:
+    /// @brief The connected component index of the grid. It is built by
+    /// labeling once, answers queries in O(1), and rebuilds itself on the next
+    /// query after the tiles change.
+    /// @return reference to the index
+    static inline Components& components() {
+        COMPONENTS.sync();
+        return COMPONENTS;
+    }
+
+    /// @brief Fold `op` over the cells of every component of `components()`
+    /// at once, in one pass over the grid.
+    /// @param init the initial accumulator of each component
+    /// @param op the function taking the accumulator and a cell, returning
+    /// the new accumulator
+    /// @return the final accumulators, indexed by component id
+    template <typename A, typename F>
+    static inline std::vector<A> reduce_components(A init, F op) {
+        auto& comp = components();
+        auto res = std::vector<A>(comp.count(), init);
+        for (auto y : rng(HEIGHT))
+            for (auto x : rng(WIDTH)) {
+                auto& acc = res[comp.label[y * WIDTH + x]];
+                acc = op(std::move(acc), BasicGrid(x, y));
+            }
+        return res;
+    }
+
+  private:
+    /// @brief Copy of the tiles surrounded by one ghost cell on each side,
+    /// with row stride `WIDTH + 2`.
+    static inline Buffer<T> HALO;
+
+  public:
+    /// @brief Refresh the ghost-cell copy of the grid read by `halo_row()`.
+    /// Ghost cells mirror the opposite edge if `Wrap`, or hold `border`
+    /// otherwise.
+    /// @param border the value of ghost cells when not wrapping
+    static inline void halo(T border = T()) {
+        auto stride = WIDTH + 2;
+        if (HALO.size() < stride * (HEIGHT + 2))
+            HALO = Buffer<T>(stride * (HEIGHT + 2));
+        for (auto y : rng(HEIGHT)) {
+            auto src = MAP.data() + y * WIDTH;
+            auto dst = HALO.data() + (y + 1) * stride;
+            std::copy(src, src + WIDTH, dst + 1);
+            dst[0] = Wrap ? src[WIDTH - 1] : border;
+            dst[WIDTH + 1] = Wrap ? src[0] : border;
+        }
+        auto last = HALO.data() + HEIGHT * stride;
+        if constexpr (Wrap) {
+            std::copy(last, last + stride, HALO.data());
+            std::copy(HALO.data() + stride, HALO.data() + 2 * stride,
+                      last + stride);
+        } else {
+            std::fill(HALO.data(), HALO.data() + stride, border);
+            std::fill(last + stride, last + 2 * stride, border);
+        }
+    }
+
+    /// @brief Row `y` of the ghost-cell copy made by `halo()`, where `y` may
+    /// be -1 or `HEIGHT` for a ghost row. Indices -1 and `WIDTH` of the row
+    /// are ghost cells.
+    /// @param y y-coordinate of the row
+    /// @return pointer to the cell at x=0 of the row
+    static inline T const* halo_row(intptr_t y) noexcept {
+        return HALO.data() + (y + 1) * (WIDTH + 2) + 1;
+    }
+
+    /// @brief Update every cell at once from its 3x3 neighborhood, such as a
+    /// step of a cellular automaton. The inner loop has no wrap or boundary
+    /// branches, so it vectorizes when `rule` inlines.
+    /// @param rule the function taking pointers to the cell in the row above,
+    /// its own row and the row below, so that offsets -1, 0 and 1 of each are
+    /// the neighborhood, and returning the new content of the cell
+    /// @param border the value of cells beyond the edge when not wrapping
+    template <typename F> static inline void stencil(F rule, T border = T()) {
+        halo(border);
+        for (auto y : rng(HEIGHT)) {
+            auto above = halo_row(intptr_t(y) - 1), row = halo_row(y),
+                 below = halo_row(y + 1);
+            auto dst = MAP.data() + y * WIDTH;
+            for (uintptr_t x = 0; x < WIDTH; x++)
+                dst[x] = rule(above + x, row + x, below + x);
+        }
+        REVISION++;
+    }
+
+    /// @brief Articulation points and bridges of the passable cells.
+    struct Cuts final {
+        /// @brief Cells whose removal disconnects their component.
+        std::vector<BasicGrid> cells;
+        /// @brief Pairs of adjacent cells whose edge is a bridge.
+        std::vector<std::pair<BasicGrid, BasicGrid>> bridges;
+    };
+
+  private:
+    /// @brief A frame of the explicit DFS stack of `cuts()`.
+    struct CutFrame final {
+        uint32_t x, y;
+        /// @brief Storage index of the DFS parent, or `-1` for a root.
+        uint32_t parent;
+        /// @brief Next direction to try, 4 when exhausted.
+        uint8_t dir;
+        /// @brief Number of DFS children.
+        uint8_t children;
+        /// @brief Whether some child subtree cannot bypass this cell.
+        bool cut;
+    };
+    static inline std::vector<CutFrame> CUT_STACK;
+    /// @brief DFS discovery time and lowlink of each visited cell.
+    static inline Buffer<uint32_t> DISC, LOW;
+
+  public:
+    /// @brief Find articulation points and bridges of the graph of cells
+    /// matching `cond`, by an iterative Tarjan lowlink pass in O(W*H).
+    /// @param cond the condition function that judges whether a cell is
+    /// passable
+    /// @return the cuts found
+    /// @note This resets all `.done()` flags, and leaves passable cells done.
+    /// @note With `Wrap`, both dimensions must be at least 3, since parallel
+    /// edges of a thinner torus are not told apart.
+    template <typename F> static inline Cuts cuts(F cond) {
+        auto n = WIDTH * HEIGHT;
+        if (DISC.size() < n) {
+            DISC = Buffer<uint32_t>(n);
+            LOW = Buffer<uint32_t>(n);
+        }
+        refresh();
+        auto res = Cuts();
+        auto& stack = CUT_STACK;
+        uint32_t time = 0;
+        auto enter = [&](uint32_t x, uint32_t y, uint32_t parent) {
+            auto i = y * WIDTH + x;
+            DONE[i] = EPOCH;
+            DISC[i] = LOW[i] = time++;
+            stack.push_back(CutFrame{x, y, parent, 0, 0, false});
+        };
+        for (auto y : rng(HEIGHT))
+            for (auto x : rng(WIDTH)) {
+                if (DONE[y * WIDTH + x] == EPOCH || !cond(BasicGrid(x, y)))
+                    continue;
+                enter(x, y, -1);
+                while (!stack.empty()) {
+                    auto& f = stack.back();
+                    auto u = f.y * WIDTH + f.x;
+                    if (f.dir < 4) {
+                        auto d = f.dir++;
+                        auto c = BasicGrid(f.x, f.y);
+                        auto g = d == 0   ? c.dy(1)
+                                 : d == 1 ? c.dx(1)
+                                 : d == 2 ? c.dx(-1)
+                                          : c.dy(-1);
+                        if (!Wrap && !g.valid())
+                            continue;
+                        auto v = g.index();
+                        if (v == f.parent || !cond(g))
+                            continue;
+                        if (DONE[v] == EPOCH)
+                            LOW[u] = std::min(LOW[u], DISC[v]);
+                        else
+                            enter(g.x, g.y, u);
+                        continue;
+                    }
+                    auto cell = BasicGrid(f.x, f.y);
+                    auto p = f.parent;
+                    if (f.cut || (p == uint32_t(-1) && f.children >= 2))
+                        res.cells.push_back(cell);
+                    stack.pop_back();
+                    if (p == uint32_t(-1))
+                        continue;
+                    auto& g = stack.back();
+                    LOW[p] = std::min(LOW[p], LOW[u]);
+                    if (LOW[u] > DISC[p])
+                        res.bridges.emplace_back(BasicGrid(g.x, g.y), cell);
+                    g.children++;
+                    if (g.parent != uint32_t(-1) && LOW[u] >= DISC[p])
+                        g.cut = true;
+                }
+            }
+        return res;
+    }
+
     /// @brief Find the next cell that matches `pat`.
     /// @param pat the pattern to match
     /// @return a `Grid` cell, may be invalid for not found
-    static inline Grid next(T const& pat) noexcept {
+    static inline BasicGrid next(T const& pat) noexcept {
         for (auto y : rng(HEIGHT))
             for (auto x : rng(WIDTH))
-                if (MAP[x][y] == pat && !Grid(x, y).done())
-                    return Grid(x, y);
-        return Grid();
+                if (MAP[y * WIDTH + x] == pat && !BasicGrid(x, y).done())
+                    return BasicGrid(x, y);
+        return BasicGrid();
     }
 
     /// @brief Count how many `pat`s is there in `Grid`.
@@ -363,12 +2884,440 @@ class Grid final {
         uint64_t ans = 0;
         for (auto y : rng(HEIGHT))
             for (auto x : rng(WIDTH))
-                if (MAP[x][y] == pat)
+                if (MAP[y * WIDTH + x] == pat)
                     ans++;
         return ans;
     }
 };
 
+/// @brief The 2D grid map with the default check policy.
+using Grid = BasicGrid<>;
+
+/// @brief The 2D toroidal grid map with the default check policy.
+using Torus = BasicGrid<LL_CHECK, true>;
+
+/// @brief A cell of the global 3D grid map, `WIDTH` by `HEIGHT` by `DEPTH`.
+/// This mirrors `BasicGrid` with one more coordinate.
+/// @tparam Conn connectivity of neighboring cells, either 6 (faces) or 26
+/// (faces, edges and corners)
+/// @tparam Check whether to assert bounds and visited-state invariants
+///
+/// The storage is cache-blocked into 4x4x4 bricks of consecutive memory, so
+/// that neighbors in every axis usually share a cache line with the cell.
+template <uint8_t Conn = 6, bool Check = LL_CHECK> class BasicGrid3 final {
+    static_assert(Conn == 6 || Conn == 26, "connectivity must be 6 or 26");
+
+  private:
+    static constexpr uintptr_t W = 64, H = 64, D = 64;
+    using T = char;
+    /// @brief Tiles, in bricks.
+    static inline Buffer<T> MAP = Buffer<T>(W * H * D);
+    /// @brief Visited stamps, in bricks. See `BasicGrid::DONE`.
+    static inline Buffer<uint8_t> DONE = Buffer<uint8_t>(W * H * D);
+    static inline uint8_t EPOCH = 1;
+    /// @brief Bumped whenever the tiles may have changed.
+    static inline uint64_t REVISION = 1;
+    /// @brief Number of bricks in x and y.
+    static inline uintptr_t BX = W / 4, BY = H / 4;
+
+  public:
+    static inline uintptr_t WIDTH = W, HEIGHT = H, DEPTH = D;
+
+    /// @brief Set the size of the grid, reallocating storage if it is not
+    /// large enough. The tiles are unspecified afterwards and all `.done()`
+    /// flags are reset.
+    /// @param width width, or the first index
+    /// @param height height, or the second index
+    /// @param depth depth, or the third index
+    static inline void set(uintptr_t width, uintptr_t height,
+                           uintptr_t depth) {
+        BX = (width + 3) / 4, BY = (height + 3) / 4;
+        auto n = BX * BY * ((depth + 3) / 4) * 64;
+        if (n > MAP.size()) {
+            MAP = Buffer<T>(n);
+            DONE = Buffer<uint8_t>(n);
+        } else
+            DONE.fill(0);
+        EPOCH = 1;
+        REVISION++;
+        WIDTH = width;
+        HEIGHT = height;
+        DEPTH = depth;
+    }
+
+    /// @brief Initialize the grid reading input from `input`, layer by layer
+    /// in z, each layer row by row in y.
+    /// @param input the stream to read
+    static inline void init(std::istream& input) noexcept {
+        for (auto z : rng(DEPTH))
+            for (auto y : rng(HEIGHT))
+                for (auto x : rng(WIDTH))
+                    input >> MAP[BasicGrid3(x, y, z).index()];
+        REVISION++;
+    }
+
+    /// @brief Output the grid to `output`, layers separated by empty lines.
+    /// @param output the stream to write to
+    static inline void output(std::ostream& output) noexcept {
+        for (auto z : rng(DEPTH)) {
+            if (z)
+                output << std::endl;
+            for (auto y : rng(HEIGHT)) {
+                for (auto x : rng(WIDTH))
+                    output << MAP[BasicGrid3(x, y, z).index()];
+                output << std::endl;
+            }
+        }
+    }
+
+    /// @brief Reset all `.done()` flags. See `BasicGrid::refresh()`.
+    static inline void refresh() noexcept {
+        if (++EPOCH == 0) {
+            DONE.fill(0);
+            EPOCH = 1;
+        }
+    }
+
+    /// @brief Reference to the `.done()` flag of a cell.
+    class Flag final {
+        uint8_t& stamp;
+
+      public:
+        constexpr Flag(uint8_t& stamp) noexcept : stamp(stamp) {}
+        constexpr operator bool() const noexcept { return stamp == EPOCH; }
+        constexpr Flag& operator=(bool value) noexcept {
+            stamp = value ? EPOCH : 0;
+            return *this;
+        }
+    };
+
+    /// @brief x-coordinate of the cell.
+    uintptr_t const x;
+
+    /// @brief y-coordinate of the cell.
+    uintptr_t const y;
+
+    /// @brief z-coordinate of the cell.
+    uintptr_t const z;
+
+    /// @brief Create an always-invalid cell.
+    constexpr BasicGrid3() noexcept : x(-1), y(-1), z(-1) {}
+
+    /// @brief Create a cell with specified coordinates.
+    /// @param x x-coordinate of the cell
+    /// @param y y-coordinate of the cell
+    /// @param z z-coordinate of the cell
+    constexpr BasicGrid3(uintptr_t x, uintptr_t y, uintptr_t z) noexcept
+        : x(x), y(y), z(z) {}
+
+    /// @brief Calculate new cell with difference `dx` in x coordinate.
+    constexpr BasicGrid3 dx(intptr_t dx) const noexcept {
+        return BasicGrid3(this->x + dx, this->y, this->z);
+    }
+
+    /// @brief Calculate new cell with difference `dy` in y coordinate.
+    constexpr BasicGrid3 dy(intptr_t dy) const noexcept {
+        return BasicGrid3(this->x, this->y + dy, this->z);
+    }
+
+    /// @brief Calculate new cell with difference `dz` in z coordinate.
+    constexpr BasicGrid3 dz(intptr_t dz) const noexcept {
+        return BasicGrid3(this->x, this->y, this->z + dz);
+    }
+
+    /// @brief Check whether two cells indicates the same position.
+    constexpr bool operator==(BasicGrid3 rhs) const noexcept {
+        return this->x == rhs.x && this->y == rhs.y && this->z == rhs.z;
+    };
+
+    /// @brief Whether this cell indicates a valid position in the grid.
+    /// @return result of check
+    constexpr bool valid() const noexcept {
+        return x < WIDTH && y < HEIGHT && z < DEPTH;
+    }
+
+    /// @brief Visit the content in specified position.
+    /// @return reference to content
+    /// @warning This does not perform any boundary check.
+    /// @note See `BasicGrid::tile()`.
+    inline Tracked<T> tile() const noexcept {
+        this->check("Grid3::tile: out of bounds");
+        return Tracked<T>(MAP[this->index()], REVISION);
+    }
+
+    /// @brief Read the content in specified position.
+    /// @return reference to content
+    /// @warning This does not perform any boundary check.
+    constexpr T const& get() const noexcept {
+        this->check("Grid3::get: out of bounds");
+        return MAP[this->index()];
+    }
+
+    /// @brief Output the cell in the format "(x, y, z)".
+    friend constexpr std::ostream& operator<<(std::ostream& output,
+                                              BasicGrid3 cell) noexcept {
+        return output << "(" << cell.x << "," << cell.y << "," << cell.z
+                      << ")";
+    }
+
+    /// @brief Flag that indicates whether a cell has been processed.
+    /// @return reference to flag
+    inline Flag done() const noexcept {
+        this->check("Grid3::done: out of bounds");
+        return DONE[this->index()];
+    }
+
+    /// @brief Gets the neighboring cells (if valid) of the given cell.
+    /// @return list of cells
+    inline std::vector<BasicGrid3> neighbor() const noexcept {
+        auto res = std::vector<BasicGrid3>();
+        this->each_neighbor([&](BasicGrid3 g) { res.push_back(g); });
+        return res;
+    }
+
+    /// @brief Traverse the grid cells that match `cond` starting from `this`,
+    /// executing `then` on each. See `BasicGrid::walk`.
+    /// @param cond the condition function that judges whether to walk into a
+    /// cell
+    /// @param then the function to execute on the cell
+    inline void walk(std::function<bool(BasicGrid3)> cond,
+                     std::function<void(BasicGrid3)> then) const noexcept {
+        if (!this->valid() || this->done() || !cond(*this))
+            return;
+        auto& stack = WALK_STACK;
+        stack.clear();
+        this->done() = true;
+        stack.push_back(WalkFrame{uint32_t(this->index()), 0});
+        while (!stack.empty()) {
+            auto& f = stack.back();
+            auto cell = at(f.i);
+            if (f.dir < 27) {
+                auto d = f.dir++;
+                intptr_t dx = d % 3 - 1, dy = d / 3 % 3 - 1, dz = d / 9 - 1;
+                auto axes = (dx != 0) + (dy != 0) + (dz != 0);
+                if (axes == 0 || (Conn == 6 && axes != 1))
+                    continue;
+                auto g = BasicGrid3(cell.x + dx, cell.y + dy, cell.z + dz);
+                if (!g.valid() || g.done() || !cond(g))
+                    continue;
+                g.done() = true;
+                stack.push_back(WalkFrame{uint32_t(g.index()), 0});
+                continue;
+            }
+            stack.pop_back();
+            if constexpr (Check)
+                if (!cell.done()) {
+                    std::cerr << cell << " ";
+                    panic("Grid3::walk: visited flag cleared during traversal");
+                }
+            then(cell);
+        }
+    }
+
+    /// @brief Traverse the grid cells that match `cond` starting from `this`
+    /// in breadth-first order. See `BasicGrid::bfs`.
+    /// @param cond the condition function that judges whether to walk into a
+    /// cell
+    /// @param then the function to execute on the cell and its distance from
+    /// `this`
+    template <typename C, typename F>
+    inline void bfs(C cond, F then) const {
+        if (!this->valid() || this->done() || !cond(*this))
+            return;
+        if (QUEUE.size() < MAP.size())
+            QUEUE = Buffer<uint32_t>(MAP.size());
+        uintptr_t head = 0, tail = 0, level = 1;
+        uint64_t dist = 0;
+        this->done() = true;
+        QUEUE[tail++] = this->index();
+        while (head < tail) {
+            if (head == level) {
+                dist++;
+                level = tail;
+            }
+            auto cell = at(QUEUE[head++]);
+            then(cell, dist);
+            cell.each_neighbor([&](BasicGrid3 g) {
+                if (g.done() || !cond(g))
+                    return;
+                g.done() = true;
+                QUEUE[tail++] = g.index();
+            });
+        }
+    }
+
+    /// @brief Connected area from this cell.
+    /// @return size of area
+    inline uint64_t conn_area() const noexcept {
+        uint64_t ans = 0;
+        auto cond = [&](BasicGrid3 g) { return g.get() == this->get(); };
+        this->bfs(cond, [&](auto, auto) { ans++; });
+        return ans;
+    }
+
+  private:
+    /// @brief Queue of storage indices for `bfs`.
+    static inline Buffer<uint32_t> QUEUE;
+
+    /// @brief Offset of this cell in the bricked storage.
+    constexpr uintptr_t index() const noexcept {
+        auto brick =
+            ((this->z >> 2) * BY + (this->y >> 2)) * BX + (this->x >> 2);
+        return brick << 6 | (this->z & 3) << 4 | (this->y & 3) << 2 |
+               (this->x & 3);
+    }
+
+    /// @brief The cell at offset `i` of the bricked storage. It may be a
+    /// padding cell that is not `valid()`.
+    static constexpr BasicGrid3 at(uintptr_t i) noexcept {
+        auto brick = i >> 6;
+        return BasicGrid3((brick % BX) << 2 | (i & 3),
+                          (brick / BX % BY) << 2 | (i >> 2 & 3),
+                          (brick / BX / BY) << 2 | (i >> 4 & 3));
+    }
+
+    /// @brief Abort with `what` if this cell is out of the grid. Generates no
+    /// code unless `Check` is enabled.
+    constexpr void check(char const* what) const noexcept {
+        if constexpr (Check)
+            if (!this->valid()) {
+                std::cerr << *this << " ";
+                panic(what);
+            }
+    }
+
+    /// @brief Execute `f` on each valid neighboring cell without allocating.
+    template <typename F> constexpr void each_neighbor(F f) const {
+        for (intptr_t dz = -1; dz <= 1; dz++)
+            for (intptr_t dy = -1; dy <= 1; dy++)
+                for (intptr_t dx = -1; dx <= 1; dx++) {
+                    auto axes = (dx != 0) + (dy != 0) + (dz != 0);
+                    if (axes == 0 || (Conn == 6 && axes != 1))
+                        continue;
+                    auto g = BasicGrid3(this->x + dx, this->y + dy,
+                                        this->z + dz);
+                    if (g.valid())
+                        f(g);
+                }
+    }
+
+    /// @brief A frame of the explicit DFS stack of `walk`.
+    struct WalkFrame final {
+        /// @brief Storage index of the cell.
+        uint32_t i;
+        /// @brief Next neighbor offset to try, in the order of
+        /// `each_neighbor()`, 27 when exhausted.
+        uint8_t dir;
+    };
+    static inline std::vector<WalkFrame> WALK_STACK;
+
+  public:
+    /// @brief Connected components of the grid, where neighboring cells with
+    /// equal tiles are connected. See `BasicGrid::Components`.
+    class Components final {
+        uint64_t revision = 0;
+        Buffer<uint32_t> label;
+        std::vector<uint64_t> sizes;
+        std::vector<uint32_t> repr;
+
+        /// @brief Label the grid with union-find, linking the larger root
+        /// under the smaller, then turn parents into ids in storage order.
+        inline void build() {
+            auto n = MAP.size();
+            if (this->label.size() < n)
+                this->label = Buffer<uint32_t>(n);
+            auto& par = this->label;
+            auto find = [&](uint32_t i) {
+                while (par[i] != i)
+                    i = par[i] = par[par[i]];
+                return i;
+            };
+            for (uint32_t i = 0; i < n; i++)
+                par[i] = i;
+            for (uint32_t i = 0; i < n; i++) {
+                auto cell = at(i);
+                if (!cell.valid())
+                    continue;
+                cell.each_neighbor([&](BasicGrid3 g) {
+                    auto j = g.index();
+                    if (j > i || MAP[j] != MAP[i])
+                        return;
+                    auto a = find(i), b = find(j);
+                    if (a < b)
+                        par[b] = a;
+                    else
+                        par[a] = b;
+                });
+            }
+            this->sizes.clear();
+            this->repr.clear();
+            for (uint32_t i = 0; i < n; i++) {
+                if (!at(i).valid())
+                    continue;
+                if (par[i] == i) {
+                    par[i] = this->repr.size();
+                    this->repr.push_back(i);
+                    this->sizes.push_back(0);
+                } else
+                    par[i] = par[par[i]];
+                this->sizes[par[i]]++;
+            }
+            this->revision = REVISION;
+        }
+
+      public:
+        /// @brief Rebuild the index if tiles have changed since last built.
+        inline void sync() {
+            if (this->revision != REVISION)
+                this->build();
+        }
+
+        /// @brief Number of components.
+        inline uintptr_t count() {
+            this->sync();
+            return this->repr.size();
+        }
+
+        /// @brief Component id of `cell`, in [0, count()).
+        inline uint32_t id(BasicGrid3 cell) {
+            cell.check("Grid3::Components: out of bounds");
+            this->sync();
+            return this->label[cell.index()];
+        }
+
+        /// @brief Size of the component containing `cell`.
+        inline uint64_t size(BasicGrid3 cell) {
+            return this->sizes[this->id(cell)];
+        }
+
+        /// @brief Whether `a` and `b` are in the same component.
+        inline bool same(BasicGrid3 a, BasicGrid3 b) {
+            return this->id(a) == this->id(b);
+        }
+
+        /// @brief The first cell in storage order of the component containing
+        /// `cell`.
+        inline BasicGrid3 representative(BasicGrid3 cell) {
+            return at(this->repr[this->id(cell)]);
+        }
+    };
+
+  private:
+    static inline Components COMPONENTS;
+
+  public:
+    /// @brief The connected component index of the grid. See
+    /// `BasicGrid::components()`.
+    /// @return reference to the index
+    static inline Components& components() {
+        COMPONENTS.sync();
+        return COMPONENTS;
+    }
+};
+
+/// @brief The 3D grid map with 6-connectivity and the default check policy.
+using Grid3 = BasicGrid3<>;
+
 /**
  * @brief Read a value from the specified <code>istream</code>.
  *